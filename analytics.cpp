@@ -0,0 +1,220 @@
+#include "analytics.h"
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+namespace
+{
+    // Spread, mid and microprice; rows with an empty side get zeros. Computed
+    // unconditionally (safe denominator) and blended with a non-short-circuit
+    // mask, and __restrict avoids 15 runtime alias checks, so GCC vectorizes it
+    void topOfBook(const double *__restrict bp, const double *__restrict bs, const double *__restrict ap,
+                   const double *__restrict as, double *__restrict sp, double *__restrict md,
+                   double *__restrict mp, size_t rows)
+    {
+        for (size_t i = 0; i < rows; i++)
+        {
+            bool valid = (bp[i] > 0.0) & (ap[i] > 0.0);
+            double top = bs[i] + as[i];
+            double weighted = (bp[i] * as[i] + ap[i] * bs[i]) / (top > 0.0 ? top : 1.0);
+            sp[i] = valid ? ap[i] - bp[i] : 0.0;
+            md[i] = valid ? 0.5 * (ap[i] + bp[i]) : 0.0;
+            mp[i] = valid ? weighted : 0.0;
+        }
+    }
+}
+
+BookAnalytics::BookAnalytics()
+{
+    clear();
+}
+
+void BookAnalytics::clear()
+{
+    block_rows = 0;
+    prev_bid_px.fill(0.0);
+    prev_bid_sz.fill(0.0);
+    prev_ask_px.fill(0.0);
+    prev_ask_sz.fill(0.0);
+
+    timestamps.clear();
+    spread.clear();
+    mid.clear();
+    microprice.clear();
+    imbalance.clear();
+    changed_levels.clear();
+    for (int l = 0; l < kLevels; l++)
+    {
+        bid_depth[l].clear();
+        ask_depth[l].clear();
+    }
+}
+
+void BookAnalytics::reserve(size_t rows)
+{
+    timestamps.reserve(rows);
+    spread.reserve(rows);
+    mid.reserve(rows);
+    microprice.reserve(rows);
+    imbalance.reserve(rows);
+    changed_levels.reserve(rows);
+    for (int l = 0; l < kLevels; l++)
+    {
+        bid_depth[l].reserve(rows);
+        ask_depth[l].reserve(rows);
+    }
+}
+
+void BookAnalytics::append(uint64_t timestamp, const std::vector<MBPLevel> &bids, const std::vector<MBPLevel> &asks)
+{
+    // Staging block is allocated on first use, so reconstructors without analytics stay cheap to create
+    if (bid_px.empty())
+    {
+        bid_px.resize(kLevels * kBlockRows);
+        bid_sz.resize(kLevels * kBlockRows);
+        ask_px.resize(kLevels * kBlockRows);
+        ask_sz.resize(kLevels * kBlockRows);
+    }
+
+    timestamps.push_back(timestamp);
+    for (int l = 0; l < kLevels; l++)
+    {
+        bid_px[l * kBlockRows + block_rows] = bids[l].price;
+        bid_sz[l * kBlockRows + block_rows] = static_cast<double>(bids[l].size);
+        ask_px[l * kBlockRows + block_rows] = asks[l].price;
+        ask_sz[l * kBlockRows + block_rows] = static_cast<double>(asks[l].size);
+    }
+
+    if (++block_rows == kBlockRows)
+    {
+        computeBlock();
+    }
+}
+
+void BookAnalytics::finish()
+{
+    if (block_rows > 0)
+    {
+        computeBlock();
+    }
+}
+
+void BookAnalytics::computeBlock()
+{
+    const size_t rows = block_rows;
+    const size_t base = spread.size();
+
+    spread.resize(base + rows);
+    mid.resize(base + rows);
+    microprice.resize(base + rows);
+    imbalance.resize(base + rows);
+    changed_levels.resize(base + rows);
+    for (int l = 0; l < kLevels; l++)
+    {
+        bid_depth[l].resize(base + rows);
+        ask_depth[l].resize(base + rows);
+    }
+
+    // Top-of-book features from the level-1 columns
+    topOfBook(bid_px.data(), bid_sz.data(), ask_px.data(), ask_sz.data(), spread.data() + base, mid.data() + base,
+              microprice.data() + base, rows);
+
+    // Cumulative depth and depth-weighted imbalance (weight 1/(level+1)), one level column at a time
+    {
+        std::array<double, kBlockRows> num{}, den{};
+        for (int l = 0; l < kLevels; l++)
+        {
+            const double w = 1.0 / (l + 1);
+            const double *bs = bid_sz.data() + l * kBlockRows, *as = ask_sz.data() + l * kBlockRows;
+            const double *bprev = l > 0 ? bid_depth[l - 1].data() + base : nullptr;
+            const double *aprev = l > 0 ? ask_depth[l - 1].data() + base : nullptr;
+            double *bd = bid_depth[l].data() + base, *ad = ask_depth[l].data() + base;
+            for (size_t i = 0; i < rows; i++)
+            {
+                bd[i] = (l > 0 ? bprev[i] : 0.0) + bs[i];
+                ad[i] = (l > 0 ? aprev[i] : 0.0) + as[i];
+                num[i] += w * (bs[i] - as[i]);
+                den[i] += w * (bs[i] + as[i]);
+            }
+        }
+        double *im = imbalance.data() + base;
+        for (size_t i = 0; i < rows; i++)
+        {
+            im[i] = den[i] > 0.0 ? num[i] / den[i] : 0.0;
+        }
+    }
+
+    // Level-change flags against the previous row; the first row of a block
+    // compares against the carried-over last row (an empty book initially)
+    {
+        uint32_t *cf = changed_levels.data() + base;
+        for (size_t i = 0; i < rows; i++)
+            cf[i] = 0;
+        for (int l = 0; l < kLevels; l++)
+        {
+            const double *bp = bid_px.data() + l * kBlockRows, *bs = bid_sz.data() + l * kBlockRows;
+            const double *ap = ask_px.data() + l * kBlockRows, *as = ask_sz.data() + l * kBlockRows;
+            const uint32_t bid_bit = 1u << l, ask_bit = 1u << (kLevels + l);
+
+            if (bp[0] != prev_bid_px[l] || bs[0] != prev_bid_sz[l])
+                cf[0] |= bid_bit;
+            if (ap[0] != prev_ask_px[l] || as[0] != prev_ask_sz[l])
+                cf[0] |= ask_bit;
+
+            for (size_t i = 1; i < rows; i++)
+            {
+                uint32_t bid_changed = (bp[i] != bp[i - 1]) | (bs[i] != bs[i - 1]);
+                uint32_t ask_changed = (ap[i] != ap[i - 1]) | (as[i] != as[i - 1]);
+                cf[i] |= (bid_changed * bid_bit) | (ask_changed * ask_bit);
+            }
+
+            prev_bid_px[l] = bp[rows - 1];
+            prev_bid_sz[l] = bs[rows - 1];
+            prev_ask_px[l] = ap[rows - 1];
+            prev_ask_sz[l] = as[rows - 1];
+        }
+    }
+
+    block_rows = 0;
+}
+
+bool BookAnalytics::writeCSV(const std::string &filename) const
+{
+    std::ofstream file(filename);
+
+    if (!file.is_open())
+    {
+        std::cerr << "Error: Could not create features file " << filename << std::endl;
+        return false;
+    }
+
+    // Write header
+    file << "timestamp,spread,mid,microprice,imbalance";
+    for (int i = 1; i <= kLevels; i++)
+    {
+        file << ",bid_depth_" << i;
+    }
+    for (int i = 1; i <= kLevels; i++)
+    {
+        file << ",ask_depth_" << i;
+    }
+    file << ",changed_levels" << std::endl;
+
+    file << std::fixed << std::setprecision(4);
+    for (size_t i = 0; i < spread.size(); i++)
+    {
+        file << timestamps[i] << "," << spread[i] << "," << mid[i] << "," << microprice[i] << "," << imbalance[i];
+        for (int l = 0; l < kLevels; l++)
+        {
+            file << "," << static_cast<int64_t>(bid_depth[l][i]);
+        }
+        for (int l = 0; l < kLevels; l++)
+        {
+            file << "," << static_cast<int64_t>(ask_depth[l][i]);
+        }
+        file << "," << changed_levels[i] << "\n";
+    }
+
+    file.close();
+    return !file.fail();
+}
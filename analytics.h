@@ -0,0 +1,53 @@
+#pragma once
+
+#include "orderbook.h"
+#include <array>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// Per-snapshot book features computed from the MBP-10 view.
+// Incoming snapshots are staged in a fixed structure-of-arrays block (one
+// column per level) so each feature is a straight loop over rows that the
+// compiler vectorizes; only the feature columns are kept once a block is done.
+class BookAnalytics
+{
+public:
+    static const int kLevels = 10;
+
+private:
+    static const size_t kBlockRows = 256; // Staged rows per block, sized to stay in L2
+
+    // Staging block, column-major: column l occupies [l * kBlockRows, (l + 1) * kBlockRows)
+    std::vector<double> bid_px, bid_sz, ask_px, ask_sz;
+    size_t block_rows = 0;
+
+    // Last row of the previous block, for level-change flags across blocks
+    std::array<double, kLevels> prev_bid_px, prev_bid_sz, prev_ask_px, prev_ask_sz;
+
+    std::vector<uint64_t> timestamps;
+    std::vector<double> spread, mid, microprice, imbalance;
+    std::array<std::vector<double>, kLevels> bid_depth, ask_depth; // Cumulative size up to each level
+    std::vector<uint32_t> changed_levels; // Bit l = bid level l changed, bit 10+l = ask level l
+
+    void computeBlock();
+
+public:
+    BookAnalytics();
+
+    void clear();
+    void reserve(size_t rows);
+    void append(uint64_t timestamp, const std::vector<MBPLevel> &bids, const std::vector<MBPLevel> &asks);
+    void finish(); // Compute features for any rows still staged
+
+    size_t size() const { return spread.size(); }
+    double getSpread(size_t row) const { return spread[row]; }
+    double getMid(size_t row) const { return mid[row]; }
+    double getMicroprice(size_t row) const { return microprice[row]; }
+    double getImbalance(size_t row) const { return imbalance[row]; }
+    double getBidDepth(size_t row, int level) const { return bid_depth[level][row]; }
+    double getAskDepth(size_t row, int level) const { return ask_depth[level][row]; }
+    uint32_t getChangedLevels(size_t row) const { return changed_levels[row]; }
+
+    bool writeCSV(const std::string &filename) const; // False if the file could not be written
+};
@@ -0,0 +1,277 @@
+#include "batch.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    // Per-worker task deque: the owner takes from the front (largest first),
+    // idle workers steal from the back
+    class TaskDeque
+    {
+    private:
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+
+    public:
+        void push(size_t task)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(task);
+        }
+
+        bool pop(size_t &task)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (tasks.empty())
+                return false;
+            task = tasks.front();
+            tasks.pop_front();
+            return true;
+        }
+
+        bool steal(size_t &task)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (tasks.empty())
+                return false;
+            task = tasks.back();
+            tasks.pop_back();
+            return true;
+        }
+    };
+
+    // CPUs interleaved across NUMA nodes, so consecutive workers land on different sockets
+    std::vector<int> workerCpus()
+    {
+        std::vector<std::vector<int>> per_node;
+        for (int node = 0; node < numaNodeCount(); node++)
+            per_node.push_back(numaCpusOfNode(node));
+
+        std::vector<int> cpus;
+        for (size_t i = 0;; i++)
+        {
+            bool any = false;
+            for (const auto &node_cpus : per_node)
+            {
+                if (i < node_cpus.size())
+                {
+                    cpus.push_back(node_cpus[i]);
+                    any = true;
+                }
+            }
+            if (!any)
+                break;
+        }
+        return cpus;
+    }
+}
+
+std::vector<std::string> listBatchInputs(const std::string &dir_or_manifest)
+{
+    std::vector<std::string> inputs;
+    std::error_code ec;
+
+    if (fs::is_directory(dir_or_manifest, ec))
+    {
+        for (const auto &entry : fs::directory_iterator(dir_or_manifest, ec))
+        {
+            std::string name = entry.path().filename().string();
+            bool is_output = name.size() >= kBatchOutputSuffix.size() &&
+                             name.compare(name.size() - kBatchOutputSuffix.size(), std::string::npos, kBatchOutputSuffix) == 0;
+            if (entry.is_regular_file(ec) && entry.path().extension() == ".csv" && !is_output)
+                inputs.push_back(entry.path().string());
+        }
+        std::sort(inputs.begin(), inputs.end());
+        return inputs;
+    }
+
+    std::ifstream manifest(dir_or_manifest);
+    if (!manifest.is_open())
+    {
+        std::cerr << "Error: Could not open batch directory or manifest " << dir_or_manifest << std::endl;
+        return inputs;
+    }
+
+    std::string line;
+    while (std::getline(manifest, line))
+    {
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+        size_t last = line.find_last_not_of(" \t\r");
+        inputs.push_back(line.substr(first, last - first + 1));
+    }
+    return inputs;
+}
+
+std::string expandOutputTemplate(const std::string &output_template, const std::string &input_file, size_t index)
+{
+    fs::path path(input_file);
+    const std::pair<std::string, std::string> fields[] = {
+        {"{name}", path.filename().string()},
+        {"{stem}", path.stem().string()},
+        {"{dir}", path.has_parent_path() ? path.parent_path().string() : "."},
+        {"{index}", std::to_string(index)},
+    };
+
+    std::string output = output_template;
+    for (const auto &field : fields)
+    {
+        for (size_t pos = output.find(field.first); pos != std::string::npos;
+             pos = output.find(field.first, pos + field.second.size()))
+        {
+            output.replace(pos, field.first.size(), field.second);
+        }
+    }
+    return output;
+}
+
+bool makeBatchTasks(const std::vector<std::string> &inputs, const std::string &output_template,
+                    std::vector<BatchTask> &tasks)
+{
+    // Normalised path -> input that claims it, so "./a.csv" and "a.csv" collide
+    std::map<std::string, std::string> claimed;
+    for (const auto &input : inputs)
+        claimed[fs::path(input).lexically_normal().string()] = input;
+
+    tasks.clear();
+    tasks.reserve(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        std::string output = expandOutputTemplate(output_template, inputs[i], i);
+        auto inserted = claimed.emplace(fs::path(output).lexically_normal().string(), inputs[i]);
+        if (!inserted.second)
+        {
+            std::cerr << "Error: Output " << output << " for " << inputs[i] << " collides with "
+                      << inserted.first->second << "; add {dir} or {index} to --output-template" << std::endl;
+            return false;
+        }
+
+        std::error_code ec;
+        uintmax_t bytes = fs::file_size(inputs[i], ec);
+        tasks.push_back({inputs[i], output, ec ? 0 : bytes});
+    }
+    return true;
+}
+
+BatchRunner::BatchRunner(const SnapshotConfig &config, int num_jobs, bool pin, HugePageMode pages)
+    : my_config(config), jobs(std::max(1, num_jobs)), pin_workers(pin), huge_pages(pages)
+{
+}
+
+std::vector<BatchResult> BatchRunner::run(const std::vector<BatchTask> &tasks)
+{
+    std::vector<BatchResult> results(tasks.size());
+    std::vector<TaskDeque> deques(jobs);
+
+    // Deal largest files first, round-robin, so the long tail is small files that steal well
+    std::vector<size_t> order(tasks.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                     { return tasks[a].input_bytes > tasks[b].input_bytes; });
+    for (size_t i = 0; i < order.size(); i++)
+        deques[i % jobs].push(order[i]);
+
+    std::vector<int> cpus = pin_workers ? workerCpus() : std::vector<int>();
+
+    auto worker = [&](int id)
+    {
+        if (!cpus.empty() || huge_pages != HugePageMode::Off)
+        {
+            int cpu = cpus.empty() ? -1 : cpus[id % cpus.size()];
+            applyWorkerPlacement(WorkerPlacement(cpu, -1, huge_pages));
+        }
+
+        // One pooled reconstructor per worker, created after placement so it lives on the local node
+        MBPReconstructor reconstructor(my_config);
+        reconstructor.setVerbose(false);
+
+        size_t task;
+        while (true)
+        {
+            bool found = deques[id].pop(task);
+            for (int victim = 1; !found && victim < jobs; victim++)
+                found = deques[(id + victim) % jobs].steal(task);
+            if (!found)
+                break;
+
+            auto start = std::chrono::high_resolution_clock::now();
+            bool ok = false;
+            try
+            {
+                ok = reconstructor.reconstruct(tasks[task].input_file, tasks[task].output_file);
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "Error: " << tasks[task].input_file << " - " << e.what() << std::endl;
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+
+            BatchResult &result = results[task];
+            result.input_file = tasks[task].input_file;
+            result.ok = ok;
+            result.events = reconstructor.getEventCount();
+            result.snapshots = reconstructor.getBidSnapshots().size();
+            result.micros = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+            result.worker = id;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < jobs; i++)
+        threads.emplace_back(worker, i);
+    for (auto &thread : threads)
+        thread.join();
+
+    return results;
+}
+
+void BatchRunner::printSummary(const std::vector<BatchResult> &results, int64_t wall_micros)
+{
+    size_t ok_files = 0;
+    size_t total_events = 0;
+    std::vector<const BatchResult *> failures;
+
+    std::cout << std::left << std::setw(48) << "file" << std::right << std::setw(8) << "status" << std::setw(12)
+              << "events" << std::setw(12) << "snapshots" << std::setw(12) << "ms" << std::setw(14) << "events/s"
+              << std::setw(8) << "worker" << "\n";
+    std::cout << std::fixed << std::setprecision(1);
+    for (const auto &result : results)
+    {
+        double seconds = result.micros / 1e6;
+        std::cout << std::left << std::setw(48) << result.input_file << std::right << std::setw(8)
+                  << (result.ok ? "ok" : "FAILED") << std::setw(12) << result.events << std::setw(12)
+                  << result.snapshots << std::setw(12) << result.micros / 1000.0 << std::setw(14)
+                  << (seconds > 0 ? result.events / seconds : 0.0) << std::setw(8) << result.worker << "\n";
+
+        if (result.ok)
+        {
+            ok_files++;
+            total_events += result.events;
+        }
+        else
+        {
+            failures.push_back(&result);
+        }
+    }
+
+    double wall_seconds = wall_micros / 1e6;
+    std::cout << "\nBatch: " << ok_files << " ok, " << failures.size() << " failed, " << total_events << " events in "
+              << wall_micros / 1000.0 << " ms (" << (wall_seconds > 0 ? total_events / wall_seconds : 0.0)
+              << " events/s)\n";
+    for (const auto *failure : failures)
+    {
+        std::cout << "  failed: " << failure->input_file << "\n";
+    }
+}
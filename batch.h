@@ -0,0 +1,54 @@
+#pragma once
+
+#include "reconstructor.h"
+#include "numa.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+struct BatchTask
+{
+    std::string input_file;
+    std::string output_file;
+    uint64_t input_bytes; // Used to start the largest files first
+};
+
+struct BatchResult
+{
+    std::string input_file;
+    bool ok = false;
+    size_t events = 0;
+    size_t snapshots = 0;
+    int64_t micros = 0;
+    int worker = -1;
+};
+
+// Suffix of the default output name; directory listings skip files ending in it
+const std::string kBatchOutputSuffix = "_mbp.csv";
+
+// Inputs from a directory (every *.csv, sorted) or a manifest (one path per line, '#' comments)
+std::vector<std::string> listBatchInputs(const std::string &dir_or_manifest);
+
+// Expands {name} (file name), {stem} (name without extension), {dir} (input directory) and {index}
+std::string expandOutputTemplate(const std::string &output_template, const std::string &input_file, size_t index);
+
+// False if two tasks would write the same output, or an output would overwrite an input
+bool makeBatchTasks(const std::vector<std::string> &inputs, const std::string &output_template,
+                    std::vector<BatchTask> &tasks);
+
+// Runs tasks on `jobs` worker threads with per-worker deques and work stealing.
+// Each worker owns one MBPReconstructor that is reset, not reallocated, between files.
+class BatchRunner
+{
+private:
+    SnapshotConfig my_config;
+    int jobs;
+    bool pin_workers;
+    HugePageMode huge_pages;
+
+public:
+    BatchRunner(const SnapshotConfig &config, int num_jobs, bool pin, HugePageMode pages);
+
+    std::vector<BatchResult> run(const std::vector<BatchTask> &tasks);
+    static void printSummary(const std::vector<BatchResult> &results, int64_t wall_micros);
+};
@@ -0,0 +1,161 @@
+#include "book_server.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Load generator for the book query server: each thread keeps one
+// connection open and issues a random mix of point, top-N and range queries.
+
+static int connectTo(const std::string &socket_path)
+{
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool query(int fd, const QueryRequest &request, QueryResponseHeader &header, std::vector<char> &body)
+{
+    if (!writeFull(fd, &request, sizeof(request)) || !readFull(fd, &header, sizeof(header)))
+        return false;
+
+    size_t body_size = 0;
+    if (request.type == QUERY_BOOK_AT || request.type == QUERY_RANGE)
+        body_size = header.count * sizeof(SnapshotRecord);
+    else if (request.type == QUERY_TOP_N)
+        body_size = 2 * header.count * sizeof(WireLevel);
+
+    body.resize(body_size);
+    return body_size == 0 || readFull(fd, body.data(), body_size);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <socket_path> [threads=4] [queries_per_thread=100000] [range_us=1000]\n";
+        return 1;
+    }
+
+    std::string socket_path = argv[1];
+    int num_threads = argc > 2 ? std::stoi(argv[2]) : 4;
+    int queries_per_thread = argc > 3 ? std::stoi(argv[3]) : 100000;
+    uint64_t range_ns = (argc > 4 ? std::stoull(argv[4]) : 1000) * 1000;
+
+    int info_fd = connectTo(socket_path);
+    if (info_fd < 0)
+    {
+        std::cerr << "Error: Could not connect to " << socket_path << std::endl;
+        return 1;
+    }
+    QueryRequest info_request = {QUERY_INFO, 0, 0, 0};
+    QueryResponseHeader info;
+    std::vector<char> body;
+    if (!query(info_fd, info_request, info, body) || info.count == 0)
+    {
+        std::cerr << "Error: Server has no history" << std::endl;
+        close(info_fd);
+        return 1;
+    }
+    close(info_fd);
+    std::cout << "Server holds " << info.count << " snapshots in [" << info.t1 << ", " << info.t2 << "]\n";
+
+    std::vector<std::vector<double>> latencies(num_threads);
+    std::vector<int> failures(num_threads, 0);
+
+    auto worker = [&](int id)
+    {
+        int fd = connectTo(socket_path);
+        if (fd < 0)
+        {
+            failures[id] = queries_per_thread;
+            return;
+        }
+
+        std::mt19937_64 rng(id + 1);
+        std::uniform_int_distribution<uint64_t> pick_time(info.t1, info.t2);
+        std::vector<char> reply;
+        latencies[id].reserve(queries_per_thread);
+
+        for (int q = 0; q < queries_per_thread; q++)
+        {
+            QueryRequest request = {QUERY_BOOK_AT, 0, pick_time(rng), 0};
+            switch (q % 4)
+            {
+            case 1:
+                request.type = QUERY_TOP_N;
+                request.limit = 5;
+                break;
+            case 2:
+                request.type = QUERY_TOP_N;
+                request.limit = 50;
+                break;
+            case 3:
+                request.type = QUERY_RANGE;
+                request.t2 = request.t1 + range_ns;
+                break;
+            default:
+                break;
+            }
+
+            QueryResponseHeader header;
+            auto start = std::chrono::high_resolution_clock::now();
+            bool ok = query(fd, request, header, reply);
+            auto end = std::chrono::high_resolution_clock::now();
+            if (!ok)
+            {
+                failures[id] += queries_per_thread - q;
+                break;
+            }
+            latencies[id].push_back(std::chrono::duration<double, std::micro>(end - start).count());
+        }
+        close(fd);
+    };
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; i++)
+        threads.emplace_back(worker, i);
+    for (auto &thread : threads)
+        thread.join();
+    auto end_time = std::chrono::high_resolution_clock::now();
+
+    std::vector<double> all;
+    int total_failures = 0;
+    for (int i = 0; i < num_threads; i++)
+    {
+        all.insert(all.end(), latencies[i].begin(), latencies[i].end());
+        total_failures += failures[i];
+    }
+    if (all.empty())
+    {
+        std::cerr << "Error: No queries completed" << std::endl;
+        return 1;
+    }
+    std::sort(all.begin(), all.end());
+
+    double seconds = std::chrono::duration<double>(end_time - start_time).count();
+    std::cout << "Queries:  " << all.size() << " ok, " << total_failures << " failed, " << num_threads << " threads\n";
+    std::cout << "QPS:      " << all.size() / seconds << "\n";
+    std::cout << "Latency:  p50 " << all[all.size() / 2] << " us, p99 " << all[all.size() * 99 / 100] << " us, max "
+              << all.back() << " us\n";
+    return total_failures == 0 ? 0 : 1;
+}
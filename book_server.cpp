@@ -0,0 +1,447 @@
+#include "book_server.h"
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <cstring>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+    // Best-first merge of a checkpoint side with the overlay of later level
+    // changes, stopping after `depth` non-empty levels; pads with zeros
+    template <typename Compare>
+    void mergeLevels(const std::vector<MBPLevel> &base, const std::map<double, int64_t, Compare> &overlay, int depth,
+                     std::vector<MBPLevel> &out)
+    {
+        Compare better;
+        out.clear();
+        out.reserve(depth);
+        size_t i = 0;
+        auto it = overlay.begin();
+        while (static_cast<int>(out.size()) < depth && (i < base.size() || it != overlay.end()))
+        {
+            if (i < base.size() && base[i].size <= 0)
+            {
+                i++; // Padding
+            }
+            else if (it == overlay.end() || (i < base.size() && better(base[i].price, it->first)))
+            {
+                out.push_back(base[i++]);
+            }
+            else
+            {
+                if (i < base.size() && base[i].price == it->first)
+                    i++; // Overridden by a later change
+                if (it->second > 0)
+                    out.emplace_back(it->first, it->second);
+                ++it;
+            }
+        }
+        out.resize(depth);
+    }
+}
+
+void BookHistory::build(const MBOActionBuffer &actions, const SnapshotConfig &config, size_t checkpoint_interval)
+{
+    if (checkpoint_interval == 0)
+        checkpoint_interval = std::max(kMinCheckpointEvents, actions.size() / kTargetCheckpoints);
+
+    MBPReconstructor reconstructor(config);
+    const OrderBook &book = reconstructor.getOrderBook();
+    updates.reserve(actions.size());
+    update_times.reserve(actions.size());
+    reconstructor.setLevelLog(&updates);
+
+    auto takeCheckpoint = [&](uint64_t timestamp)
+    {
+        Checkpoint checkpoint;
+        checkpoint.timestamp = timestamp;
+        checkpoint.update_index = updates.size();
+        checkpoint.bids = book.getBidLevels(book.getBidDepth());
+        checkpoint.asks = book.getAskLevels(book.getAskDepth());
+        checkpoints.push_back(std::move(checkpoint));
+    };
+
+    // Checkpoints are only taken between timestamps, so a checkpoint never
+    // holds half of the events that share its timestamp
+    size_t events_since_checkpoint = 0;
+    for (size_t i = 0; i < actions.size(); i++)
+    {
+        if (events_since_checkpoint >= checkpoint_interval && actions[i].timestamp != actions[i - 1].timestamp)
+        {
+            takeCheckpoint(actions[i - 1].timestamp);
+            events_since_checkpoint = 0;
+        }
+        reconstructor.processAction(actions[i]);
+        update_times.resize(updates.size(), actions[i].timestamp);
+        events_since_checkpoint++;
+    }
+    reconstructor.flush();
+    reconstructor.setLevelLog(nullptr);
+    if (!actions.empty())
+    {
+        takeCheckpoint(actions.back().timestamp);
+        first_timestamp = actions.front().timestamp;
+        has_events = true;
+    }
+
+    const auto &bid_snapshots = reconstructor.getBidSnapshots();
+    const auto &ask_snapshots = reconstructor.getAskSnapshots();
+    timestamps.resize(bid_snapshots.size());
+    levels.resize(bid_snapshots.size() * 2 * kLevels);
+    for (size_t row = 0; row < bid_snapshots.size(); row++)
+    {
+        timestamps[row] = bid_snapshots.getTimestamp(row);
+        std::copy(bid_snapshots.getLevels(row), bid_snapshots.getLevels(row) + kLevels, levels.begin() + row * 2 * kLevels);
+        std::copy(ask_snapshots.getLevels(row), ask_snapshots.getLevels(row) + kLevels,
+                  levels.begin() + row * 2 * kLevels + kLevels);
+    }
+}
+
+long BookHistory::findSnapshot(uint64_t t) const
+{
+    auto it = std::upper_bound(timestamps.begin(), timestamps.end(), t);
+    return static_cast<long>(it - timestamps.begin()) - 1;
+}
+
+std::pair<size_t, size_t> BookHistory::findRange(uint64_t t1, uint64_t t2) const
+{
+    size_t begin = std::lower_bound(timestamps.begin(), timestamps.end(), t1) - timestamps.begin();
+    size_t end = std::upper_bound(timestamps.begin(), timestamps.end(), t2) - timestamps.begin();
+    return std::make_pair(begin, std::max(begin, end));
+}
+
+const BookHistory::Checkpoint *BookHistory::findCheckpoint(uint64_t t) const
+{
+    auto it = std::upper_bound(checkpoints.begin(), checkpoints.end(), t,
+                               [](uint64_t value, const Checkpoint &checkpoint)
+                               { return value < checkpoint.timestamp; });
+    if (it == checkpoints.begin())
+        return nullptr;
+    return &*(it - 1);
+}
+
+bool BookHistory::topLevelsAt(uint64_t t, int depth, std::vector<MBPLevel> &bids, std::vector<MBPLevel> &asks,
+                              uint64_t &as_of) const
+{
+    if (!has_events || t < first_timestamp)
+        return false;
+
+    static const std::vector<MBPLevel> kEmptySide;
+    const Checkpoint *checkpoint = findCheckpoint(t);
+    size_t begin = checkpoint != nullptr ? checkpoint->update_index : 0;
+    size_t end = std::upper_bound(update_times.begin() + begin, update_times.end(), t) - update_times.begin();
+
+    // Later changes to the same level overwrite earlier ones
+    std::map<double, int64_t, std::greater<double>> bid_overlay;
+    std::map<double, int64_t> ask_overlay;
+    for (size_t i = begin; i < end; i++)
+    {
+        if (updates[i].side == 'B')
+            bid_overlay[updates[i].price] = updates[i].size;
+        else
+            ask_overlay[updates[i].price] = updates[i].size;
+    }
+
+    as_of = end > 0 ? update_times[end - 1] : first_timestamp;
+    mergeLevels(checkpoint != nullptr ? checkpoint->bids : kEmptySide, bid_overlay, depth, bids);
+    mergeLevels(checkpoint != nullptr ? checkpoint->asks : kEmptySide, ask_overlay, depth, asks);
+    return true;
+}
+
+bool readFull(int fd, void *buffer, size_t n)
+{
+    char *out = static_cast<char *>(buffer);
+    while (n > 0)
+    {
+        ssize_t got = recv(fd, out, n, 0);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            return false;
+        out += got;
+        n -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+bool writeFull(int fd, const void *buffer, size_t n)
+{
+    const char *in = static_cast<const char *>(buffer);
+    while (n > 0)
+    {
+        ssize_t sent = send(fd, in, n, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            return false;
+        in += sent;
+        n -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+BookServer::BookServer(const BookHistory &book_history, const std::string &path)
+    : history(book_history), socket_path(path), listen_fd(-1), running(false), next_client_id(0)
+{
+}
+
+BookServer::~BookServer()
+{
+    stop();
+    // Still open if run() was never called
+    int fd = listen_fd.exchange(-1);
+    if (fd >= 0)
+        close(fd);
+}
+
+bool BookServer::start()
+{
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(addr.sun_path))
+    {
+        std::cerr << "Error: Socket path too long " << socket_path << std::endl;
+        return false;
+    }
+    std::strcpy(addr.sun_path, socket_path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        std::cerr << "Error: Could not create socket - " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    unlink(socket_path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || listen(fd, 128) < 0)
+    {
+        std::cerr << "Error: Could not listen on " << socket_path << " - " << std::strerror(errno) << std::endl;
+        close(fd);
+        return false;
+    }
+
+    listen_fd = fd;
+    running = true;
+    return true;
+}
+
+void BookServer::run()
+{
+    const int fd = listen_fd;
+    while (running)
+    {
+        int client_fd = accept(fd, nullptr, nullptr);
+        if (client_fd < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        // stop() clears `running` before taking the lock, so a late accept is never left behind
+        if (!running)
+        {
+            close(client_fd);
+            break;
+        }
+        for (uint64_t id : finished_clients)
+        {
+            clients[id].thread.join();
+            clients.erase(id);
+        }
+        finished_clients.clear();
+
+        uint64_t id = next_client_id++;
+        Client &client = clients[id];
+        client.fd = client_fd;
+        client.thread = std::thread(&BookServer::handleClient, this, id, client_fd);
+    }
+
+    // The accept loop owns the listening socket; stop() only shuts it down, so
+    // the descriptor is never closed (and reused) while accept() may still use it
+    std::lock_guard<std::mutex> lock(clients_mutex);
+    int closing = listen_fd.exchange(-1);
+    if (closing >= 0)
+        close(closing);
+}
+
+void BookServer::stop()
+{
+    if (running.exchange(false))
+    {
+        {
+            std::lock_guard<std::mutex> lock(clients_mutex);
+            if (listen_fd >= 0)
+                shutdown(listen_fd, SHUT_RDWR);
+        }
+        unlink(socket_path.c_str());
+    }
+
+    // Wake every reader blocked on its socket, then wait for all of them to exit
+    std::map<uint64_t, Client> remaining;
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        for (auto &entry : clients)
+        {
+            if (entry.second.fd >= 0)
+                shutdown(entry.second.fd, SHUT_RDWR);
+        }
+        remaining.swap(clients);
+        finished_clients.clear();
+    }
+    for (auto &entry : remaining)
+        entry.second.thread.join();
+}
+
+void BookServer::handleClient(uint64_t id, int fd)
+{
+    QueryRequest request;
+    std::vector<char> reply;
+    reply.reserve(sizeof(QueryResponseHeader) + sizeof(SnapshotRecord));
+
+    while (readFull(fd, &request, sizeof(request)))
+    {
+        answer(request, reply);
+        if (!writeFull(fd, reply.data(), reply.size()))
+            break;
+    }
+
+    // Hand the fd back before closing it, so stop() never shuts down a reused descriptor
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        auto it = clients.find(id);
+        if (it != clients.end())
+        {
+            it->second.fd = -1;
+            finished_clients.push_back(id);
+        }
+    }
+    close(fd);
+}
+
+void BookServer::answer(const QueryRequest &request, std::vector<char> &reply) const
+{
+    QueryResponseHeader header = {STATUS_OK, 0, 0, 0};
+    reply.resize(sizeof(header));
+
+    auto appendSnapshot = [&](size_t row)
+    {
+        SnapshotRecord record;
+        record.timestamp = history.getTimestamp(row);
+        const MBPLevel *bids = history.getBids(row);
+        const MBPLevel *asks = history.getAsks(row);
+        for (int l = 0; l < BookHistory::kLevels; l++)
+        {
+            record.bids[l] = {bids[l].price, bids[l].size};
+            record.asks[l] = {asks[l].price, asks[l].size};
+        }
+        const char *bytes = reinterpret_cast<const char *>(&record);
+        reply.insert(reply.end(), bytes, bytes + sizeof(record));
+    };
+
+    auto appendLevels = [&](const MBPLevel *source, size_t available, uint32_t n)
+    {
+        for (uint32_t l = 0; l < n; l++)
+        {
+            WireLevel level = {0.0, 0};
+            if (l < available)
+                level = {source[l].price, source[l].size};
+            const char *bytes = reinterpret_cast<const char *>(&level);
+            reply.insert(reply.end(), bytes, bytes + sizeof(level));
+        }
+    };
+
+    switch (request.type)
+    {
+    case QUERY_INFO:
+        header.count = static_cast<uint32_t>(history.size());
+        if (history.size() > 0)
+        {
+            header.t1 = history.getTimestamp(0);
+            header.t2 = history.getTimestamp(history.size() - 1);
+        }
+        break;
+    case QUERY_BOOK_AT:
+    {
+        long row = history.findSnapshot(request.t1);
+        if (row < 0)
+        {
+            header.status = STATUS_NOT_FOUND;
+            break;
+        }
+        header.count = 1;
+        header.t1 = history.getTimestamp(row);
+        appendSnapshot(row);
+        break;
+    }
+    case QUERY_RANGE:
+    {
+        if (request.t2 < request.t1)
+        {
+            header.status = STATUS_BAD_REQUEST;
+            break;
+        }
+        auto range = history.findRange(request.t1, request.t2);
+        uint32_t limit = request.limit == 0 ? kMaxRangeRows : std::min(request.limit, kMaxRangeRows);
+        size_t rows = range.second - range.first;
+        if (rows > limit)
+        {
+            rows = limit;
+            header.status = STATUS_TRUNCATED;
+        }
+        header.count = static_cast<uint32_t>(rows);
+        reply.reserve(sizeof(header) + rows * sizeof(SnapshotRecord));
+        for (size_t row = range.first; row < range.first + rows; row++)
+            appendSnapshot(row);
+        break;
+    }
+    case QUERY_TOP_N:
+    {
+        if (request.limit == 0 || request.limit > kMaxRangeRows)
+        {
+            header.status = STATUS_BAD_REQUEST;
+            break;
+        }
+        header.count = request.limit;
+        if (request.limit <= static_cast<uint32_t>(BookHistory::kLevels))
+        {
+            long row = history.findSnapshot(request.t1);
+            if (row < 0)
+            {
+                header.status = STATUS_NOT_FOUND;
+                header.count = 0;
+                break;
+            }
+            header.t1 = history.getTimestamp(row);
+            appendLevels(history.getBids(row), BookHistory::kLevels, request.limit);
+            appendLevels(history.getAsks(row), BookHistory::kLevels, request.limit);
+        }
+        else
+        {
+            // Deeper than MBP-10: replay from the latest full-book checkpoint
+            std::vector<MBPLevel> bids, asks;
+            if (!history.topLevelsAt(request.t1, static_cast<int>(request.limit), bids, asks, header.t1))
+            {
+                header.status = STATUS_NOT_FOUND;
+                header.count = 0;
+                break;
+            }
+            header.t2 = 1;
+            appendLevels(bids.data(), bids.size(), request.limit);
+            appendLevels(asks.data(), asks.size(), request.limit);
+        }
+        break;
+    }
+    default:
+        header.status = STATUS_BAD_REQUEST;
+        break;
+    }
+
+    std::memcpy(reply.data(), &header, sizeof(header));
+}
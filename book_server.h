@@ -0,0 +1,154 @@
+#pragma once
+
+#include "orderbook.h"
+#include "reconstructor.h"
+#include <vector>
+#include <string>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <cstdint>
+
+// Binary protocol spoken over the Unix domain socket. All fields are in
+// host byte order; client and server are expected to run on the same box.
+enum QueryType : uint32_t
+{
+    QUERY_INFO = 0,    // -> count = snapshots, t1/t2 = first/last timestamp
+    QUERY_BOOK_AT = 1, // t1 = T -> one SnapshotRecord, latest at or before T
+    QUERY_RANGE = 2,   // [t1, t2], limit = max rows (0 = server cap) -> count SnapshotRecords
+    QUERY_TOP_N = 3    // t1 = T, limit = N -> N bid WireLevels then N ask WireLevels, t1 = last book change <= T
+};
+
+enum QueryStatus : uint32_t
+{
+    STATUS_OK = 0,
+    STATUS_NOT_FOUND = 1,
+    STATUS_BAD_REQUEST = 2,
+    STATUS_TRUNCATED = 3 // Range reply hit the row limit
+};
+
+struct QueryRequest
+{
+    uint32_t type;
+    uint32_t limit;
+    uint64_t t1;
+    uint64_t t2;
+};
+
+struct QueryResponseHeader
+{
+    uint32_t status;
+    uint32_t count;
+    uint64_t t1; // Timestamp of the returned state (INFO: first timestamp)
+    uint64_t t2; // INFO: last timestamp; TOP_N: 1 if rebuilt at full depth from a checkpoint
+};
+
+struct WireLevel
+{
+    double price;
+    int64_t size;
+};
+
+struct SnapshotRecord
+{
+    uint64_t timestamp;
+    WireLevel bids[10];
+    WireLevel asks[10];
+};
+
+static_assert(sizeof(QueryRequest) == 24, "QueryRequest must be packed");
+static_assert(sizeof(QueryResponseHeader) == 24, "QueryResponseHeader must be packed");
+static_assert(sizeof(SnapshotRecord) == 328, "SnapshotRecord must be packed");
+
+// Day's MBP-10 history plus every price-level change and periodic
+// full-depth checkpoints of the levels. Built once, then only read, so any
+// number of threads may query it without locking.
+class BookHistory
+{
+public:
+    static const int kLevels = 10;
+    // Default checkpoint spacing: about kTargetCheckpoints per day, but never
+    // closer than kMinCheckpointEvents events
+    static constexpr size_t kTargetCheckpoints = 512;
+    static constexpr size_t kMinCheckpointEvents = 1000;
+
+    struct Checkpoint
+    {
+        uint64_t timestamp;
+        size_t update_index;        // Level changes [0, update_index) are included
+        std::vector<MBPLevel> bids; // Best first, full depth
+        std::vector<MBPLevel> asks;
+    };
+
+private:
+    std::vector<uint64_t> timestamps;
+    std::vector<MBPLevel> levels; // Per snapshot: kLevels bids then kLevels asks
+    std::vector<Checkpoint> checkpoints;
+    std::vector<uint64_t> update_times; // Timestamp of the event behind each level change
+    std::vector<LevelUpdate> updates;
+    uint64_t first_timestamp = 0;
+    bool has_events = false;
+
+public:
+    // checkpoint_interval = 0 picks one from the number of events
+    void build(const MBOActionBuffer &actions, const SnapshotConfig &config, size_t checkpoint_interval);
+
+    size_t size() const { return timestamps.size(); }
+    size_t checkpointCount() const { return checkpoints.size(); }
+    size_t updateCount() const { return updates.size(); }
+    uint64_t getTimestamp(size_t row) const { return timestamps[row]; }
+    const MBPLevel *getBids(size_t row) const { return &levels[row * 2 * kLevels]; }
+    const MBPLevel *getAsks(size_t row) const { return &levels[row * 2 * kLevels + kLevels]; }
+
+    // Index of the latest snapshot at or before t, or -1 if t precedes the day
+    long findSnapshot(uint64_t t) const;
+    // Half-open row range of snapshots with timestamps in [t1, t2]
+    std::pair<size_t, size_t> findRange(uint64_t t1, uint64_t t2) const;
+    // Latest checkpoint at or before t, or nullptr
+    const Checkpoint *findCheckpoint(uint64_t t) const;
+
+    // Exact top-`depth` book after every event at or before t: the latest
+    // checkpoint's levels overlaid with the level changes since. False if t
+    // precedes the day; `as_of` is the timestamp of the last change applied.
+    bool topLevelsAt(uint64_t t, int depth, std::vector<MBPLevel> &bids, std::vector<MBPLevel> &asks,
+                     uint64_t &as_of) const;
+};
+
+class BookServer
+{
+private:
+    static constexpr uint32_t kMaxRangeRows = 65536;
+
+    const BookHistory &history;
+    std::string socket_path;
+    std::atomic<int> listen_fd; // Written by stop() from another thread
+    std::atomic<bool> running;
+
+    // Live connections keyed by connection id; fd is -1 once the client thread
+    // has stopped using it. Finished threads are joined on the next accept.
+    struct Client
+    {
+        int fd;
+        std::thread thread;
+    };
+    std::mutex clients_mutex;
+    std::map<uint64_t, Client> clients;
+    std::vector<uint64_t> finished_clients;
+    uint64_t next_client_id;
+
+    void handleClient(uint64_t id, int fd);
+    void answer(const QueryRequest &request, std::vector<char> &reply) const;
+
+public:
+    BookServer(const BookHistory &book_history, const std::string &path);
+    ~BookServer();
+
+    bool start(); // Bind and listen; false on error
+    void run();   // Accept loop, one reader thread per connection
+    void stop();  // Stops accepting, shuts down open connections and joins their threads
+};
+
+// Read/write exactly n bytes, retrying on short transfers; false on EOF or error
+bool readFull(int fd, void *buffer, size_t n);
+bool writeFull(int fd, const void *buffer, size_t n);
@@ -30,15 +30,49 @@ std::vector<std::string> CSVParser::split(const std::string &line, char delimite
     return tokens;
 }
 
-std::vector<MBOAction> CSVParser::parseCSV(const std::string &filename)
+bool CSVParser::parseLine(const std::string &line, MBOAction &action)
 {
-    std::vector<MBOAction> actions;
+    if (line.empty())
+        return false;
+
+    std::vector<std::string> tokens = split(line, ',');
+    if (tokens.size() < 6)
+        return false;
+
+    try
+    {
+        action.timestamp = std::stoull(tokens[0]);
+        action.action = tokens[1][0];
+        action.side = tokens[2][0];
+        action.price = std::stod(tokens[3]);
+        action.size = std::stoll(tokens[4]);
+        action.order_id = std::stoull(tokens[5]);
+        action.sequence = tokens.size() > 6 && !tokens[6].empty() ? std::stoull(tokens[6]) : 0;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error parsing line: " << line << " - " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+MBOActionBuffer CSVParser::parseCSV(const std::string &filename)
+{
+    MBOActionBuffer actions;
+    parseCSV(filename, actions);
+    return actions;
+}
+
+bool CSVParser::parseCSV(const std::string &filename, MBOActionBuffer &actions)
+{
+    actions.clear();
     std::ifstream file(filename);
 
     if (!file.is_open())
     {
         std::cerr << "Error: Could not open file " << filename << std::endl;
-        return actions;
+        return false;
     }
 
     std::string line;
@@ -52,46 +86,25 @@ std::vector<MBOAction> CSVParser::parseCSV(const std::string &filename)
             continue; // Skip header
         }
 
-        if (line.empty())
-            continue;
-
-        std::vector<std::string> tokens = split(line, ',');
-        if (tokens.size() < 6)
-            continue;
-
         MBOAction action;
-        try
-        {
-            action.timestamp = std::stoull(tokens[0]);
-            action.action = tokens[1][0];
-            action.side = tokens[2][0];
-            action.price = std::stod(tokens[3]);
-            action.size = std::stoll(tokens[4]);
-            action.order_id = std::stoull(tokens[5]);
-
+        if (parseLine(line, action))
             actions.push_back(action);
-        }
-        catch (const std::exception &e)
-        {
-            std::cerr << "Error parsing line: " << line << " - " << e.what() << std::endl;
-            continue;
-        }
     }
 
     file.close();
-    return actions;
+    return true;
 }
 
-void CSVParser::writeMBP(const std::string &filename,
-                         const std::vector<std::pair<uint64_t, std::vector<MBPLevel>>> &bid_snapshots,
-                         const std::vector<std::pair<uint64_t, std::vector<MBPLevel>>> &ask_snapshots)
+bool CSVParser::writeMBP(const std::string &filename,
+                         const MBPSnapshotBuffer &bid_snapshots,
+                         const MBPSnapshotBuffer &ask_snapshots)
 {
     std::ofstream file(filename);
 
     if (!file.is_open())
     {
         std::cerr << "Error: Could not create output file " << filename << std::endl;
-        return;
+        return false;
     }
 
     // Write header
@@ -120,22 +133,24 @@ void CSVParser::writeMBP(const std::string &filename,
 
         if (bid_idx < bid_snapshots.size())
         {
-            next_timestamp = std::min(next_timestamp, bid_snapshots[bid_idx].first);
+            next_timestamp = std::min(next_timestamp, bid_snapshots.getTimestamp(bid_idx));
         }
         if (ask_idx < ask_snapshots.size())
         {
-            next_timestamp = std::min(next_timestamp, ask_snapshots[ask_idx].first);
+            next_timestamp = std::min(next_timestamp, ask_snapshots.getTimestamp(ask_idx));
         }
 
-        if (bid_idx < bid_snapshots.size() && bid_snapshots[bid_idx].first == next_timestamp)
+        if (bid_idx < bid_snapshots.size() && bid_snapshots.getTimestamp(bid_idx) == next_timestamp)
         {
-            current_bids = bid_snapshots[bid_idx].second;
+            const MBPLevel *row = bid_snapshots.getLevels(bid_idx);
+            current_bids.assign(row, row + MBPSnapshotBuffer::kLevels);
             bid_idx++;
             use_bid = true;
         }
-        if (ask_idx < ask_snapshots.size() && ask_snapshots[ask_idx].first == next_timestamp)
+        if (ask_idx < ask_snapshots.size() && ask_snapshots.getTimestamp(ask_idx) == next_timestamp)
         {
-            current_asks = ask_snapshots[ask_idx].second;
+            const MBPLevel *row = ask_snapshots.getLevels(ask_idx);
+            current_asks.assign(row, row + MBPSnapshotBuffer::kLevels);
             ask_idx++;
             use_ask = true;
         }
@@ -170,4 +185,5 @@ void CSVParser::writeMBP(const std::string &filename,
     }
 
     file.close();
+    return !file.fail();
 }
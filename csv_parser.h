@@ -1,10 +1,44 @@
 #pragma once
 
 #include "orderbook.h"
+#include "numa.h"
 #include <vector>
 #include <string>
 #include <fstream>
 
+// Per-run buffers large enough to benefit from huge pages and node binding
+typedef std::vector<MBOAction, HugePageAllocator<MBOAction>> MBOActionBuffer;
+
+// One side's MBP-10 rows stored flat, so the levels themselves (not just a
+// per-row header pointing at small heap blocks) live in the large buffer
+class MBPSnapshotBuffer
+{
+public:
+    static const int kLevels = 10;
+
+private:
+    std::vector<uint64_t, HugePageAllocator<uint64_t>> timestamps;
+    std::vector<MBPLevel, HugePageAllocator<MBPLevel>> levels; // kLevels per row
+
+public:
+    void push(uint64_t timestamp, const std::vector<MBPLevel> &row)
+    {
+        timestamps.push_back(timestamp);
+        levels.insert(levels.end(), row.begin(), row.begin() + kLevels);
+    }
+
+    void clear()
+    {
+        timestamps.clear();
+        levels.clear();
+    }
+
+    size_t size() const { return timestamps.size(); }
+    bool empty() const { return timestamps.empty(); }
+    uint64_t getTimestamp(size_t row) const { return timestamps[row]; }
+    const MBPLevel *getLevels(size_t row) const { return &levels[row * kLevels]; }
+};
+
 class CSVParser
 {
 private:
@@ -15,7 +49,9 @@ public:
     CSVParser();
     ~CSVParser();
 
-    std::vector<MBOAction> parseCSV(const std::string &filename);
-    void writeMBP(const std::string &filename, const std::vector<std::pair<uint64_t, std::vector<MBPLevel>>> &bid_snapshots,
-                  const std::vector<std::pair<uint64_t, std::vector<MBPLevel>>> &ask_snapshots);
+    bool parseLine(const std::string &line, MBOAction &action); // False for blank/short/malformed lines
+    MBOActionBuffer parseCSV(const std::string &filename);
+    bool parseCSV(const std::string &filename, MBOActionBuffer &actions); // Reuses `actions`; false if unreadable
+    bool writeMBP(const std::string &filename, const MBPSnapshotBuffer &bid_snapshots,
+                  const MBPSnapshotBuffer &ask_snapshots);
 };
@@ -0,0 +1,191 @@
+#include "merge.h"
+#include <iostream>
+#include <algorithm>
+
+MBOStreamReader::MBOStreamReader(const std::string &filename, size_t chunk_size, size_t chunks_ahead)
+    : filename(filename), file(filename), chunk_actions(std::max<size_t>(1, chunk_size)), max_chunks(std::max<size_t>(1, chunks_ahead))
+{
+    open = file.is_open();
+    if (!open)
+    {
+        std::cerr << "Error: Could not open file " << filename << std::endl;
+        finished = true;
+        return;
+    }
+    worker = std::thread(&MBOStreamReader::readAhead, this);
+}
+
+MBOStreamReader::~MBOStreamReader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    chunk_taken.notify_all();
+    if (worker.joinable())
+        worker.join();
+}
+
+void MBOStreamReader::readAhead()
+{
+    std::string line;
+    std::getline(file, line); // Skip header
+
+    std::vector<MBOAction> chunk;
+    chunk.reserve(chunk_actions);
+
+    auto publish = [&]()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        chunk_taken.wait(lock, [&]
+                         { return chunks.size() < max_chunks || stopping; });
+        if (stopping)
+            return false;
+        chunks.push_back(std::move(chunk));
+        chunk_ready.notify_one();
+        return true;
+    };
+
+    bool have_last = false;
+    uint64_t last_timestamp = 0;
+    uint64_t last_sequence = 0;
+    size_t line_number = 1;
+
+    while (std::getline(file, line))
+    {
+        line_number++;
+        MBOAction action;
+        if (!parser.parseLine(line, action))
+            continue;
+
+        // The merge relies on every source already being in (timestamp, sequence) order
+        if (have_last && (action.timestamp < last_timestamp ||
+                          (action.timestamp == last_timestamp && action.sequence < last_sequence)))
+        {
+            std::cerr << "Error: " << filename << " is not sorted by timestamp, sequence at line " << line_number << std::endl;
+            std::lock_guard<std::mutex> lock(mutex);
+            unsorted = true;
+            break;
+        }
+        have_last = true;
+        last_timestamp = action.timestamp;
+        last_sequence = action.sequence;
+        chunk.push_back(action);
+
+        if (chunk.size() == chunk_actions)
+        {
+            if (!publish())
+                return;
+            chunk = std::vector<MBOAction>();
+            chunk.reserve(chunk_actions);
+        }
+    }
+    if (!chunk.empty() && !publish())
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    finished = true;
+    chunk_ready.notify_one();
+}
+
+bool MBOStreamReader::next(MBOAction &action)
+{
+    if (position == current.size())
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        chunk_ready.wait(lock, [&]
+                         { return !chunks.empty() || finished; });
+        if (chunks.empty())
+            return false;
+        current = std::move(chunks.front());
+        chunks.pop_front();
+        position = 0;
+        lock.unlock();
+        chunk_taken.notify_one();
+    }
+    action = current[position++];
+    return true;
+}
+
+bool MBOStreamReader::isSorted()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return !unsorted;
+}
+
+MBOMerger::MBOMerger(const std::vector<std::string> &files, size_t chunk_size, size_t chunks_ahead)
+{
+    const size_t k = files.size();
+    heads.resize(k);
+    exhausted.resize(k);
+    for (size_t i = 0; i < k; i++)
+    {
+        readers.emplace_back(new MBOStreamReader(files[i], chunk_size, chunks_ahead));
+        all_open = readers[i]->isOpen() && all_open;
+        exhausted[i] = !readers[i]->next(heads[i]);
+        all_sorted = (!exhausted[i] || readers[i]->isSorted()) && all_sorted;
+    }
+
+    losers.resize(std::max<size_t>(1, k));
+    if (k > 0)
+        losers[0] = build(1);
+}
+
+// Exhausted sources lose to everything; equal keys fall back to the source index
+bool MBOMerger::beats(size_t a, size_t b) const
+{
+    if (exhausted[a])
+        return false;
+    if (exhausted[b])
+        return true;
+    if (heads[a].timestamp != heads[b].timestamp)
+        return heads[a].timestamp < heads[b].timestamp;
+    if (heads[a].sequence != heads[b].sequence)
+        return heads[a].sequence < heads[b].sequence;
+    return a < b;
+}
+
+// Nodes 1..K-1 are internal, K..2K-1 are the leaves for sources 0..K-1
+size_t MBOMerger::build(size_t node)
+{
+    const size_t k = readers.size();
+    if (node >= k)
+        return node - k;
+
+    size_t left = build(2 * node);
+    size_t right = build(2 * node + 1);
+    if (beats(left, right))
+    {
+        losers[node] = right;
+        return left;
+    }
+    losers[node] = left;
+    return right;
+}
+
+bool MBOMerger::next(MBOAction &action)
+{
+    const size_t k = readers.size();
+    if (k == 0)
+        return false;
+
+    size_t winner = losers[0];
+    if (exhausted[winner] || !all_sorted)
+        return false;
+    action = heads[winner];
+    exhausted[winner] = !readers[winner]->next(heads[winner]);
+    if (exhausted[winner] && !readers[winner]->isSorted())
+    {
+        // Emit nothing further once a source breaks order, so the run fails at this event
+        all_sorted = false;
+    }
+
+    // Replay the refilled leaf up to the root, swapping with any stored loser that now wins
+    for (size_t node = (winner + k) / 2; node > 0; node /= 2)
+    {
+        if (beats(losers[node], winner))
+            std::swap(losers[node], winner);
+    }
+    losers[0] = winner;
+    return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "csv_parser.h"
+#include <vector>
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+// Reads one sorted MBO file on a background thread, parsing ahead into a
+// bounded queue of fixed-size chunks so memory stays flat whatever the file size.
+// Reading stops at the first event whose (timestamp, sequence) goes backwards.
+class MBOStreamReader
+{
+private:
+    std::string filename;
+    std::ifstream file; // Only touched by the reader thread once it has started
+    bool open = false;  // Recorded before the thread starts, so isOpen() never races it
+    CSVParser parser;
+    size_t chunk_actions;
+    size_t max_chunks;
+
+    std::mutex mutex;
+    std::condition_variable chunk_ready;
+    std::condition_variable chunk_taken;
+    std::deque<std::vector<MBOAction>> chunks;
+    bool finished = false; // Producer reached end of file
+    bool stopping = false; // Consumer is being destroyed
+    bool unsorted = false; // Producer stopped at an out-of-order event
+
+    std::vector<MBOAction> current; // Chunk being consumed, owned by the consumer
+    size_t position = 0;
+
+    std::thread worker;
+
+    void readAhead();
+
+public:
+    MBOStreamReader(const std::string &filename, size_t chunk_size, size_t chunks_ahead);
+    ~MBOStreamReader();
+
+    bool isOpen() const { return open; }
+    bool next(MBOAction &action); // False once the file is exhausted or found unsorted
+    bool isSorted();              // Valid once next() has returned false
+};
+
+// K-way merge of sorted MBO streams by (timestamp, sequence, source index)
+// using a loser tree: each event costs one leaf-to-root pass of log2(K) compares.
+class MBOMerger
+{
+private:
+    std::vector<std::unique_ptr<MBOStreamReader>> readers;
+    std::vector<MBOAction> heads; // Current front event of each source
+    std::vector<bool> exhausted;
+    std::vector<size_t> losers; // losers[0] = overall winner, losers[1..K-1] = internal nodes
+    bool all_open = true;
+    bool all_sorted = true;
+
+    bool beats(size_t a, size_t b) const;
+    size_t build(size_t node);
+
+public:
+    static constexpr size_t kChunkActions = 4096;
+    static constexpr size_t kChunksAhead = 4;
+
+    explicit MBOMerger(const std::vector<std::string> &files, size_t chunk_size = kChunkActions,
+                       size_t chunks_ahead = kChunksAhead);
+
+    bool allOpen() const { return all_open; }
+    bool allSorted() const { return all_sorted; }
+    bool next(MBOAction &action); // False once every source is exhausted, or one is found unsorted
+};
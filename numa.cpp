@@ -0,0 +1,215 @@
+#include "numa.h"
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <cstring>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <linux/perf_event.h>
+
+namespace
+{
+    const size_t kHugePageBytes = 2 * 1024 * 1024;
+
+    // Placement of the calling thread, consulted by allocateLarge()
+    thread_local HugePageMode current_huge_pages = HugePageMode::Off;
+    thread_local int current_node = -1;
+
+    bool nodeMask(int node, unsigned long &mask)
+    {
+        if (node < 0 || node >= static_cast<int>(8 * sizeof(unsigned long)))
+            return false;
+        mask = 1UL << node;
+        return true;
+    }
+
+    int openCounter(uint64_t cache, uint64_t op, uint64_t result)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = cache | (op << 8) | (result << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    int64_t readCounter(int fd)
+    {
+        int64_t value = 0;
+        if (fd < 0 || read(fd, &value, sizeof(value)) != sizeof(value))
+            return -1;
+        return value;
+    }
+}
+
+std::vector<int> parseCpuList(const std::string &list)
+{
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ','))
+    {
+        if (range.empty())
+            continue;
+        size_t dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; cpu++)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+int numaNodeCount()
+{
+    int nodes = 0;
+    while (std::ifstream("/sys/devices/system/node/node" + std::to_string(nodes) + "/cpulist").good())
+        nodes++;
+    return nodes > 0 ? nodes : 1;
+}
+
+std::vector<int> numaCpusOfNode(int node)
+{
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string list;
+    if (file.is_open() && std::getline(file, list))
+        return parseCpuList(list);
+
+    // No sysfs topology: treat the machine as a single node
+    std::vector<int> cpus;
+    if (node == 0)
+    {
+        for (unsigned cpu = 0; cpu < std::thread::hardware_concurrency(); cpu++)
+            cpus.push_back(static_cast<int>(cpu));
+    }
+    return cpus;
+}
+
+int numaNodeOfCpu(int cpu)
+{
+    int nodes = numaNodeCount();
+    for (int node = 0; node < nodes; node++)
+    {
+        for (int c : numaCpusOfNode(node))
+        {
+            if (c == cpu)
+                return node;
+        }
+    }
+    return 0;
+}
+
+bool applyWorkerPlacement(const WorkerPlacement &placement)
+{
+    bool ok = true;
+    current_huge_pages = placement.huge_pages;
+    current_node = placement.memory_node;
+
+    if (placement.cpu >= 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(placement.cpu, &set);
+        ok = sched_setaffinity(0, sizeof(set), &set) == 0 && ok;
+        if (current_node < 0)
+            current_node = numaNodeOfCpu(placement.cpu);
+    }
+
+    // Bind the thread's default policy too, so the book maps and order index
+    // (many small malloc'd nodes) are faulted in on the same node
+    unsigned long mask;
+    if (nodeMask(current_node, mask))
+    {
+        ok = syscall(SYS_set_mempolicy, MPOL_BIND, &mask, 8 * sizeof(mask) + 1) == 0 && ok;
+    }
+    else
+    {
+        syscall(SYS_set_mempolicy, MPOL_DEFAULT, nullptr, 0);
+    }
+    return ok;
+}
+
+void *allocateLarge(size_t bytes)
+{
+    size_t length = (bytes + kHugePageBytes - 1) / kHugePageBytes * kHugePageBytes;
+    void *ptr = MAP_FAILED;
+
+    if (current_huge_pages == HugePageMode::Explicit)
+    {
+        ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+    if (ptr == MAP_FAILED)
+    {
+        // Over-map and trim so the block starts on a huge-page boundary,
+        // which transparent huge pages need to back it fully
+        void *raw = mmap(nullptr, length + kHugePageBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED)
+            throw std::bad_alloc();
+        uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+        uintptr_t aligned = (start + kHugePageBytes - 1) / kHugePageBytes * kHugePageBytes;
+        if (aligned > start)
+            munmap(raw, aligned - start);
+        munmap(reinterpret_cast<void *>(aligned + length), start + kHugePageBytes - aligned);
+        ptr = reinterpret_cast<void *>(aligned);
+
+        if (current_huge_pages != HugePageMode::Off)
+            madvise(ptr, length, MADV_HUGEPAGE);
+    }
+
+    unsigned long mask;
+    if (nodeMask(current_node, mask))
+    {
+        syscall(SYS_mbind, ptr, length, MPOL_BIND, &mask, 8 * sizeof(mask) + 1, 0);
+    }
+    return ptr;
+}
+
+void freeLarge(void *ptr, size_t bytes)
+{
+    size_t length = (bytes + kHugePageBytes - 1) / kHugePageBytes * kHugePageBytes;
+    munmap(ptr, length);
+}
+
+PerfCounters::PerfCounters()
+{
+    tlb_fd = openCounter(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+    remote_fd = openCounter(PERF_COUNT_HW_CACHE_NODE, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+}
+
+PerfCounters::~PerfCounters()
+{
+    if (tlb_fd >= 0)
+        close(tlb_fd);
+    if (remote_fd >= 0)
+        close(remote_fd);
+}
+
+void PerfCounters::start()
+{
+    for (int fd : {tlb_fd, remote_fd})
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+int64_t PerfCounters::dtlbMisses() const
+{
+    return readCounter(tlb_fd);
+}
+
+int64_t PerfCounters::remoteNodeLoads() const
+{
+    return readCounter(remote_fd);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+// NUMA placement and huge-page support using plain Linux syscalls only
+// (sched_setaffinity, set_mempolicy, mbind, mmap/madvise, perf_event_open).
+
+enum class HugePageMode
+{
+    Off,         // Regular 4K pages
+    Transparent, // madvise(MADV_HUGEPAGE) on large buffers
+    Explicit     // MAP_HUGETLB from the reserved pool, falls back to Transparent
+};
+
+struct WorkerPlacement
+{
+    int cpu;         // Core to pin to, -1 = leave unpinned
+    int memory_node; // Node to bind allocations to, -1 = node of `cpu` (none if unpinned)
+    HugePageMode huge_pages;
+
+    WorkerPlacement() : cpu(-1), memory_node(-1), huge_pages(HugePageMode::Off) {}
+    WorkerPlacement(int c, int node, HugePageMode mode) : cpu(c), memory_node(node), huge_pages(mode) {}
+};
+
+// Expands a sysfs cpulist such as "0-3,8,10-11"
+std::vector<int> parseCpuList(const std::string &list);
+
+int numaNodeCount();
+int numaNodeOfCpu(int cpu);
+std::vector<int> numaCpusOfNode(int node);
+
+// Pins the calling thread and binds its future allocations; false if any step failed
+bool applyWorkerPlacement(const WorkerPlacement &placement);
+
+// Blocks at least this large bypass malloc and are mapped directly, so they
+// can be backed by huge pages and bound to the calling thread's node
+const size_t kLargeBufferBytes = 2 * 1024 * 1024;
+
+void *allocateLarge(size_t bytes);
+void freeLarge(void *ptr, size_t bytes);
+
+// Stateless allocator for the big per-run buffers (parsed actions, snapshot
+// levels). Small requests go to operator new; large ones to allocateLarge().
+template <typename T>
+struct HugePageAllocator
+{
+    typedef T value_type;
+
+    HugePageAllocator() {}
+    template <typename U>
+    HugePageAllocator(const HugePageAllocator<U> &) {}
+
+    T *allocate(size_t n)
+    {
+        size_t bytes = n * sizeof(T);
+        if (bytes >= kLargeBufferBytes)
+            return static_cast<T *>(allocateLarge(bytes));
+        return static_cast<T *>(::operator new(bytes));
+    }
+
+    void deallocate(T *ptr, size_t n)
+    {
+        size_t bytes = n * sizeof(T);
+        if (bytes >= kLargeBufferBytes)
+            freeLarge(ptr, bytes);
+        else
+            ::operator delete(ptr);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const HugePageAllocator<T> &, const HugePageAllocator<U> &) { return true; }
+template <typename T, typename U>
+bool operator!=(const HugePageAllocator<T> &, const HugePageAllocator<U> &) { return false; }
+
+// Per-thread hardware counters for the NUMA benchmark; counters the kernel
+// refuses (no PMU access, virtual machines) read back as -1
+class PerfCounters
+{
+private:
+    int tlb_fd;
+    int remote_fd;
+
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    void start();
+    int64_t dtlbMisses() const;
+    int64_t remoteNodeLoads() const;
+};
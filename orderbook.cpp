@@ -19,6 +19,29 @@ void OrderBook::clear()
     orders.clear();
 }
 
+// Level sizes only ever change through these, so the log sees every change
+void OrderBook::adjustBid(double price, int64_t delta)
+{
+    int64_t &size = bids[price];
+    size += delta;
+    int64_t new_size = size;
+    if (new_size <= 0)
+        bids.erase(price);
+    if (level_log != nullptr)
+        level_log->emplace_back('B', price, std::max<int64_t>(new_size, 0));
+}
+
+void OrderBook::adjustAsk(double price, int64_t delta)
+{
+    int64_t &size = asks[price];
+    size += delta;
+    int64_t new_size = size;
+    if (new_size <= 0)
+        asks.erase(price);
+    if (level_log != nullptr)
+        level_log->emplace_back('A', price, std::max<int64_t>(new_size, 0));
+}
+
 void OrderBook::addOrder(char side, double price, int64_t size, uint64_t order_id)
 {
     if (size <= 0)
@@ -29,11 +52,11 @@ void OrderBook::addOrder(char side, double price, int64_t size, uint64_t order_i
 
     if (side == 'B')
     {
-        bids[price] += size;
+        adjustBid(price, size);
     }
     else if (side == 'A')
     {
-        asks[price] += size;
+        adjustAsk(price, size);
     }
 }
 
@@ -49,15 +72,11 @@ void OrderBook::cancelOrder(uint64_t order_id)
 
     if (bids.count(price))
     {
-        bids[price] -= size;
-        if (bids[price] <= 0)
-            bids.erase(price);
+        adjustBid(price, -size);
     }
     else if (asks.count(price))
     {
-        asks[price] -= size;
-        if (asks[price] <= 0)
-            asks.erase(price);
+        adjustAsk(price, -size);
     }
 
     orders.erase(it);
@@ -77,20 +96,12 @@ void OrderBook::processTradeSequence(const MBOAction &trade, const MBOAction &fi
     if (actual_side == 'B')
     {
         if (bids.count(price))
-        {
-            bids[price] -= trade_size;
-            if (bids[price] <= 0)
-                bids.erase(price);
-        }
+            adjustBid(price, -trade_size);
     }
     else if (actual_side == 'A')
     {
         if (asks.count(price))
-        {
-            asks[price] -= trade_size;
-            if (asks[price] <= 0)
-                asks.erase(price);
-        }
+            adjustAsk(price, -trade_size);
     }
 
     // Update or erase order
@@ -110,7 +121,7 @@ std::vector<MBPLevel> OrderBook::getBidLevels(int max_levels) const
     levels.reserve(max_levels);
 
     int count = 0;
-    for (auto it = bids.rbegin(); it != bids.rend() && count < max_levels; ++it)
+    for (auto it = bids.begin(); it != bids.end() && count < max_levels; ++it)
     {
         if (it->second > 0)
         {
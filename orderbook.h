@@ -23,8 +23,9 @@ struct MBOAction
     double price;
     int64_t size;
     uint64_t order_id;
+    uint64_t sequence; // Optional 7th column; tiebreak for equal timestamps when merging sources
 
-    MBOAction() : timestamp(0), action(0), side(0), price(0.0), size(0), order_id(0) {}
+    MBOAction() : timestamp(0), action(0), side(0), price(0.0), size(0), order_id(0), sequence(0) {}
 };
 
 struct MBPLevel
@@ -36,6 +37,17 @@ struct MBPLevel
     MBPLevel(double p, int64_t s) : price(p), size(s) {}
 };
 
+// New aggregate size of one price level after an event; 0 = level removed
+struct LevelUpdate
+{
+    double price;
+    int64_t size;
+    char side;
+
+    LevelUpdate() : price(0.0), size(0), side(0) {}
+    LevelUpdate(char s, double p, int64_t sz) : price(p), size(sz), side(s) {}
+};
+
 class OrderBook
 {
 private:
@@ -47,6 +59,12 @@ private:
     // Track individual orders for cancellations
     std::map<uint64_t, Order> orders;
 
+    // Optional sink for every level change, used to record a day's history
+    std::vector<LevelUpdate> *level_log = nullptr;
+
+    void adjustBid(double price, int64_t delta);
+    void adjustAsk(double price, int64_t delta);
+
 public:
     OrderBook();
     ~OrderBook();
@@ -55,9 +73,12 @@ public:
     void addOrder(char side, double price, int64_t size, uint64_t order_id);
     void cancelOrder(uint64_t order_id);
     void processTradeSequence(const MBOAction &trade, const MBOAction &fill, const MBOAction &cancel);
+    void setLevelLog(std::vector<LevelUpdate> *log) { level_log = log; }
 
     std::vector<MBPLevel> getBidLevels(int max_levels = 10) const;
     std::vector<MBPLevel> getAskLevels(int max_levels = 10) const;
+    int getBidDepth() const { return static_cast<int>(bids.size()); }
+    int getAskDepth() const { return static_cast<int>(asks.size()); }
 
     void printBook() const; // For debugging
 };
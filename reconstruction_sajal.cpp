@@ -1,125 +1,461 @@
-#include "orderbook.h"
-#include "csv_parser.h"
+#include "reconstructor.h"
+#include "book_server.h"
+#include "batch.h"
 #include <iostream>
+#include <string>
 #include <vector>
-#include <map>
 #include <chrono>
+#include <thread>
+#include <iomanip>
+#include <sstream>
+#include <atomic>
+#include <algorithm>
+#include <csignal>
+#include <pthread.h>
 
-class MBPReconstructor
+static void printUsage(const char *program)
 {
-private:
-    OrderBook my_orderbook;
-    CSVParser my_csv_parser;
+    std::cerr << "Usage: " << program
+              << " [--conflate | --sample-us N | --sample-events N] [--features FILE] [--bench-analytics]"
+              << " [--pin-cpu N] [--huge-pages thp|explicit] [--bench-numa]"
+              << " [--serve SOCKET [--checkpoint-events N]] <input_mbo.csv> [more_inputs.csv ...]\n";
+    std::cerr << "       Several inputs are merged by timestamp (then sequence column) into one book\n";
+    std::cerr << "       " << program
+              << " [snapshot options] --batch DIR|MANIFEST [--output-template T] [--jobs N] [--pin-workers]"
+              << " [--huge-pages thp|explicit]\n";
+}
 
-    std::vector<std::pair<uint64_t, std::vector<MBPLevel>>> all_bid_snapshots;
-    std::vector<std::pair<uint64_t, std::vector<MBPLevel>>> all_ask_snapshots;
+// Reconstructs every input of a directory or manifest on a work-stealing pool
+static int runBatch(const std::string &batch_source, const std::string &output_template, int jobs, bool pin_workers,
+                    const SnapshotConfig &config, HugePageMode huge_pages)
+{
+    auto inputs = listBatchInputs(batch_source);
+    if (inputs.empty())
+    {
+        std::cerr << "Error: No input files in " << batch_source << std::endl;
+        return 1;
+    }
 
-    struct TradeInProgress
+    std::vector<BatchTask> tasks;
+    if (!makeBatchTasks(inputs, output_template, tasks))
+        return 1;
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    BatchRunner runner(config, jobs, pin_workers, huge_pages);
+    auto results = runner.run(tasks);
+    auto end_time = std::chrono::high_resolution_clock::now();
+
+    BatchRunner::printSummary(results, std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count());
+    for (const auto &result : results)
     {
-        MBOAction trade_action;
-        MBOAction fill_action;
-        bool got_trade = false;
-        bool got_fill = false;
-    };
+        if (!result.ok)
+            return 1;
+    }
+    return 0;
+}
+
+// Builds the day's history once and answers point-in-time queries until killed
+static int serveHistory(const std::string &input_file, const SnapshotConfig &config, const std::string &socket_path,
+                        size_t checkpoint_interval)
+{
+    // SIGINT/SIGTERM are taken by a waiter thread rather than a handler, so
+    // shutdown runs as ordinary code; the mask is inherited by every thread
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, nullptr);
 
-    std::map<uint64_t, TradeInProgress> trades_waiting_for_completion;
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    CSVParser parser;
+    BookHistory history;
+    history.build(parser.parseCSV(input_file), config, checkpoint_interval);
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+    std::cout << "Built " << history.size() << " snapshots and " << history.checkpointCount() << " checkpoints in "
+              << duration.count() << " microseconds\n";
+
+    BookServer server(history, socket_path);
+    if (!server.start())
+        return 1;
 
-    void takeSnapshot(uint64_t timestamp)
+    std::thread signal_waiter([&]
+                              {
+                                  int signal = 0;
+                                  sigwait(&stop_signals, &signal);
+                                  server.stop(); // Unblocks run(), joins clients, removes the socket file
+                              });
+    std::cout << "Serving on " << socket_path << std::endl;
+    server.run();
+
+    // run() can also end on an accept error; wake the waiter so it can be joined
+    pthread_kill(signal_waiter.native_handle(), SIGTERM);
+    signal_waiter.join();
+    std::cout << "Server stopped" << std::endl;
+    return 0;
+}
+
+// Replays the same parsed events with and without the analytics stage
+// and reports the extra cost of computing features in-stream
+static void benchAnalytics(const std::string &input_file, const SnapshotConfig &config)
+{
+    CSVParser parser;
+    auto actions = parser.parseCSV(input_file);
+
+    auto run = [&](bool with_analytics)
     {
-        auto bids = my_orderbook.getBidLevels(10);
-        auto asks = my_orderbook.getAskLevels(10);
+        MBPReconstructor reconstructor(config);
+        if (with_analytics)
+            reconstructor.enableAnalytics();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (const auto &action : actions)
+        {
+            reconstructor.processAction(action);
+        }
+        reconstructor.flush();
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    };
+
+    run(false); // Warm-up
+    auto plain_us = run(false);
+    auto analytics_us = run(true);
+
+    std::cout << "Plain reconstruction:     " << plain_us << " microseconds\n";
+    std::cout << "With in-stream analytics: " << analytics_us << " microseconds\n";
+    if (plain_us > 0)
+        std::cout << "Analytics overhead:       " << (100.0 * (analytics_us - plain_us) / plain_us) << "%\n";
+}
 
-        all_bid_snapshots.emplace_back(timestamp, bids);
-        all_ask_snapshots.emplace_back(timestamp, asks);
+// Runs one reconstruction worker per NUMA node under several placements and
+// reports time, dTLB misses and remote-node loads for each, and the change
+// against the unpinned baseline. Each worker parses its own copy of the
+// input after placement (so it lands on the chosen node) and warms up
+// before the timed passes, so file I/O and a cold page cache stay out of it.
+static void benchNuma(const std::string &input_file, const SnapshotConfig &config, HugePageMode huge_pages)
+{
+    const int nodes = numaNodeCount();
+    std::vector<int> worker_cpus;
+    for (int node = 0; node < nodes; node++)
+    {
+        auto cpus = numaCpusOfNode(node);
+        if (!cpus.empty())
+            worker_cpus.push_back(cpus[0]);
     }
+    if (worker_cpus.empty())
+        worker_cpus.push_back(-1);
 
-    void processAction(const MBOAction &action)
+    struct Variant
     {
-        switch (action.action)
-        {
-        case 'R':
-            break;
-        case 'A':
-            my_orderbook.addOrder(action.side, action.price, action.size, action.order_id);
-            takeSnapshot(action.timestamp);
-            break;
-        case 'C':
+        const char *name;
+        bool pin;
+        int node_offset; // Memory node = (cpu's node + offset) % nodes
+        HugePageMode pages;
+    };
+    std::vector<Variant> variants = {
+        {"unpinned, 4K pages", false, 0, HugePageMode::Off},
+        {"pinned, local node, 4K pages", true, 0, HugePageMode::Off},
+        {"pinned, local node, huge pages", true, 0, huge_pages == HugePageMode::Off ? HugePageMode::Transparent : huge_pages},
+    };
+    if (nodes > 1)
+        variants.push_back({"pinned, remote node, huge pages", true, 1, variants.back().pages});
+
+    const int kTimedPasses = 5; // Best of, per worker
+
+    std::cout << nodes << " NUMA node(s), " << worker_cpus.size() << " worker(s), best of " << kTimedPasses
+              << " passes after a warm-up\n";
+    std::cout << std::left << std::setw(34) << "placement" << std::right << std::setw(14) << "time (us)"
+              << std::setw(12) << "vs base" << std::setw(16) << "dTLB misses" << std::setw(12) << "vs base"
+              << std::setw(16) << "remote loads" << "\n";
+
+    auto show = [](int64_t value)
+    { return value < 0 ? std::string("n/a") : std::to_string(value); };
+    auto change = [](int64_t value, int64_t base)
+    {
+        if (value < 0 || base <= 0)
+            return std::string("n/a");
+        std::ostringstream out;
+        out << std::showpos << std::fixed << std::setprecision(1) << 100.0 * (value - base) / base << "%";
+        return out.str();
+    };
+    int64_t base_time = -1, base_tlb = -1;
+
+    for (const auto &variant : variants)
+    {
+        const size_t num_workers = worker_cpus.size();
+        std::vector<int64_t> micros(num_workers), tlb(num_workers), remote(num_workers);
+        std::atomic<bool> placed(true);
+        std::atomic<size_t> ready(0);
+
+        auto run_worker = [&](size_t w)
         {
-            auto it = trades_waiting_for_completion.find(action.order_id);
-            if (it != trades_waiting_for_completion.end())
+            int cpu = variant.pin ? worker_cpus[w] : -1;
+            int node = cpu >= 0 ? (numaNodeOfCpu(cpu) + variant.node_offset) % nodes : -1;
+            if (!applyWorkerPlacement(WorkerPlacement(cpu, node, variant.pages)))
+                placed = false;
+
+            // Everything below is allocated after placement, so it lands on `node`
+            CSVParser parser;
+            auto actions = parser.parseCSV(input_file);
+            MBPReconstructor reconstructor(config);
+            reconstructor.setVerbose(false);
+            PerfCounters counters;
+
+            auto pass = [&]()
             {
-                auto &info = it->second;
-                if (info.got_trade && info.got_fill)
+                reconstructor.reset();
+                for (const auto &action : actions)
                 {
-                    my_orderbook.processTradeSequence(info.trade_action, info.fill_action, action);
-                    trades_waiting_for_completion.erase(it);
-                    takeSnapshot(action.timestamp);
-                    break;
+                    reconstructor.processAction(action);
                 }
-            }
-            my_orderbook.cancelOrder(action.order_id);
-            takeSnapshot(action.timestamp);
-            break;
-        }
-        case 'T':
-            if (action.side != 'N')
+                reconstructor.flush();
+            };
+            pass(); // Warm-up
+
+            // Start the timed passes together, so the workers contend for memory as in a real run
+            ready++;
+            while (ready < num_workers)
+                std::this_thread::yield();
+
+            micros[w] = -1;
+            for (int p = 0; p < kTimedPasses; p++)
             {
-                auto &info = trades_waiting_for_completion[action.order_id];
-                info.trade_action = action;
-                info.got_trade = true;
+                counters.start();
+                auto start = std::chrono::high_resolution_clock::now();
+                pass();
+                auto end = std::chrono::high_resolution_clock::now();
+                int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+                if (micros[w] < 0 || us < micros[w])
+                {
+                    micros[w] = us;
+                    tlb[w] = counters.dtlbMisses();
+                    remote[w] = counters.remoteNodeLoads();
+                }
             }
-            break;
-        case 'F':
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t w = 0; w < num_workers; w++)
+            workers.emplace_back(run_worker, w);
+        for (auto &worker : workers)
+            worker.join();
+
+        // The slowest worker bounds the parallel run; counters are summed
+        int64_t time = 0, tlb_total = 0, remote_total = 0;
+        for (size_t w = 0; w < num_workers; w++)
         {
-            auto &info = trades_waiting_for_completion[action.order_id];
-            info.fill_action = action;
-            info.got_fill = true;
-            break;
+            time = std::max(time, micros[w]);
+            tlb_total = (tlb[w] < 0 || tlb_total < 0) ? -1 : tlb_total + tlb[w];
+            remote_total = (remote[w] < 0 || remote_total < 0) ? -1 : remote_total + remote[w];
         }
-        default:
-            std::cerr << "Unknown action: " << action.action << std::endl;
-            break;
+        if (base_time < 0)
+        {
+            base_time = time;
+            base_tlb = tlb_total;
         }
-    }
 
-public:
-    // Main reconstruction function
-    void reconstruct(const std::string &input_file, const std::string &output_file)
-    {
-        auto start_time = std::chrono::high_resolution_clock::now();
+        std::cout << std::left << std::setw(34) << variant.name << std::right << std::setw(14) << time << std::setw(12)
+                  << change(time, base_time) << std::setw(16) << show(tlb_total) << std::setw(12)
+                  << change(tlb_total, base_tlb) << std::setw(16) << show(remote_total)
+                  << (placed ? "" : "  (placement failed)") << "\n";
+    }
+}
 
-        auto actions = my_csv_parser.parseCSV(input_file);
+int main(int argc, char *argv[])
+{
+    SnapshotConfig config;
+    std::string input_file;
+    std::vector<std::string> extra_inputs; // Further sorted sources to merge with input_file
+    std::string features_file;
+    bool bench_analytics = false;
+    std::string socket_path;
+    size_t checkpoint_interval = 0; // 0 = scaled to the input size
+    WorkerPlacement placement;
+    bool bench_numa = false;
+    std::string batch_source;
+    std::string output_template = "{dir}/{stem}" + kBatchOutputSuffix;
+    int jobs = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    bool pin_workers = false;
 
-        for (const auto &action : actions)
+    try
+    {
+        for (int i = 1; i < argc; i++)
         {
-            processAction(action);
+            std::string arg = argv[i];
+            if (arg == "--conflate")
+            {
+                config = SnapshotConfig(SnapshotMode::Conflate, 0);
+            }
+            else if ((arg == "--sample-us" || arg == "--sample-events") && i + 1 < argc)
+            {
+                SnapshotMode mode = (arg == "--sample-us") ? SnapshotMode::SampleTime : SnapshotMode::SampleEvents;
+                config = SnapshotConfig(mode, std::stoull(argv[++i]));
+            }
+            else if (arg == "--features" && i + 1 < argc)
+            {
+                features_file = argv[++i];
+            }
+            else if (arg == "--serve" && i + 1 < argc)
+            {
+                socket_path = argv[++i];
+            }
+            else if (arg == "--checkpoint-events" && i + 1 < argc)
+            {
+                checkpoint_interval = std::stoull(argv[++i]);
+            }
+            else if (arg == "--pin-cpu" && i + 1 < argc)
+            {
+                placement.cpu = std::stoi(argv[++i]);
+            }
+            else if (arg == "--huge-pages" && i + 1 < argc)
+            {
+                std::string mode = argv[++i];
+                if (mode != "thp" && mode != "explicit")
+                {
+                    printUsage(argv[0]);
+                    return 1;
+                }
+                placement.huge_pages = (mode == "thp") ? HugePageMode::Transparent : HugePageMode::Explicit;
+            }
+            else if (arg == "--batch" && i + 1 < argc)
+            {
+                batch_source = argv[++i];
+            }
+            else if (arg == "--output-template" && i + 1 < argc)
+            {
+                output_template = argv[++i];
+            }
+            else if (arg == "--jobs" && i + 1 < argc)
+            {
+                jobs = std::stoi(argv[++i]);
+            }
+            else if (arg == "--pin-workers")
+            {
+                pin_workers = true;
+            }
+            else if (arg == "--bench-numa")
+            {
+                bench_numa = true;
+            }
+            else if (arg == "--bench-analytics")
+            {
+                bench_analytics = true;
+            }
+            else if (input_file.empty() && arg[0] != '-')
+            {
+                input_file = arg;
+            }
+            else if (arg[0] != '-')
+            {
+                extra_inputs.push_back(arg);
+            }
+            else
+            {
+                printUsage(argv[0]);
+                return 1;
+            }
         }
+    }
+    catch (const std::exception &e)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
 
-        my_csv_parser.writeMBP(output_file, all_bid_snapshots, all_ask_snapshots);
+    // Only plain reconstruction merges several inputs; the other modes read one file
+    if (!extra_inputs.empty() && (!batch_source.empty() || !socket_path.empty() || bench_analytics || bench_numa))
+    {
+        std::cerr << "Error: Several inputs are only supported for plain reconstruction" << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
 
-        auto end_time = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+    if (!batch_source.empty())
+    {
+        if (!input_file.empty())
+        {
+            std::cerr << "Error: --batch reads its inputs from DIR|MANIFEST, not " << input_file << std::endl;
+            return 1;
+        }
+        // Per-run options that have no per-file meaning in a batch
+        const char *unsupported = !features_file.empty() ? "--features"
+                                  : placement.cpu >= 0   ? "--pin-cpu"
+                                  : !socket_path.empty() ? "--serve"
+                                  : bench_analytics      ? "--bench-analytics"
+                                  : bench_numa           ? "--bench-numa"
+                                                         : nullptr;
+        if (unsupported != nullptr)
+        {
+            std::cerr << "Error: " << unsupported << " is not supported with --batch" << std::endl;
+            return 1;
+        }
+        try
+        {
+            return runBatch(batch_source, output_template, jobs, pin_workers, config, placement.huge_pages);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
 
-        std::cout << "Reconstruction completed in " << duration.count() << " microseconds\n";
-        std::cout << "Generated " << all_bid_snapshots.size() << " snapshots\n";
+    if (input_file.empty())
+    {
+        printUsage(argv[0]);
+        return 1;
     }
-};
 
-int main(int argc, char *argv[])
-{
-    if (argc != 2)
+    // Only plain reconstruction writes a features file
+    const char *features_mode = !socket_path.empty() ? "--serve"
+                                : bench_analytics    ? "--bench-analytics"
+                                : bench_numa         ? "--bench-numa"
+                                                     : nullptr;
+    if (!features_file.empty() && features_mode != nullptr)
     {
-        std::cerr << "Usage: " << argv[0] << " <input_mbo.csv>\n";
+        std::cerr << "Error: --features is not supported with " << features_mode << std::endl;
         return 1;
     }
 
-    std::string input_file = argv[1];
     std::string output_file = "mbp_output.csv";
 
     try
     {
-        MBPReconstructor reconstructor;
-        reconstructor.reconstruct(input_file, output_file);
+        if (bench_numa)
+        {
+            benchNuma(input_file, config, placement.huge_pages);
+            return 0;
+        }
+        if ((placement.cpu >= 0 || placement.huge_pages != HugePageMode::Off) && !applyWorkerPlacement(placement))
+        {
+            std::cerr << "Warning: Could not apply CPU/memory placement" << std::endl;
+        }
+        if (bench_analytics)
+        {
+            benchAnalytics(input_file, config);
+            return 0;
+        }
+        if (!socket_path.empty())
+        {
+            return serveHistory(input_file, config, socket_path, checkpoint_interval);
+        }
+
+        MBPReconstructor reconstructor(config);
+        if (!features_file.empty())
+            reconstructor.enableAnalytics(features_file);
+        if (!extra_inputs.empty())
+        {
+            extra_inputs.insert(extra_inputs.begin(), input_file);
+            if (!reconstructor.reconstructMerged(extra_inputs, output_file))
+                return 1;
+        }
+        else if (!reconstructor.reconstruct(input_file, output_file))
+        {
+            return 1;
+        }
         std::cout << "Reconstruction successful!\n";
         return 0;
     }
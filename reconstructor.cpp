@@ -0,0 +1,225 @@
+#include "reconstructor.h"
+#include "merge.h"
+#include <iostream>
+#include <chrono>
+#include <utility>
+
+MBPReconstructor::MBPReconstructor(const SnapshotConfig &config) : my_config(config)
+{
+    // A zero interval would never fire, fall back to one row per event
+    if ((my_config.mode == SnapshotMode::SampleTime || my_config.mode == SnapshotMode::SampleEvents) &&
+        my_config.interval == 0)
+    {
+        my_config.mode = SnapshotMode::EveryEvent;
+    }
+}
+
+void MBPReconstructor::reset()
+{
+    my_orderbook.clear();
+    my_analytics.clear();
+    all_bid_snapshots.clear();
+    all_ask_snapshots.clear();
+    trades_waiting_for_completion.clear();
+
+    book_dirty = false;
+    last_change_timestamp = 0;
+    changes_since_start = 0;
+    next_sample_time = 0;
+    clock_started = false;
+    event_count = 0;
+}
+
+void MBPReconstructor::takeSnapshot(uint64_t timestamp)
+{
+    auto bids = my_orderbook.getBidLevels(10);
+    auto asks = my_orderbook.getAskLevels(10);
+
+    if (analytics_enabled)
+        my_analytics.append(timestamp, bids, asks);
+
+    all_ask_snapshots.push(timestamp, asks);
+    all_bid_snapshots.push(timestamp, bids);
+    book_dirty = false;
+}
+
+// Called before an action is applied, so the book still reflects every
+// event strictly before `timestamp`
+void MBPReconstructor::beforeAction(uint64_t timestamp)
+{
+    switch (my_config.mode)
+    {
+    case SnapshotMode::Conflate:
+        if (book_dirty && timestamp != last_change_timestamp)
+            takeSnapshot(last_change_timestamp);
+        break;
+    case SnapshotMode::SampleTime:
+    {
+        const uint64_t interval_ns = my_config.interval * 1000;
+        if (!clock_started)
+        {
+            next_sample_time = ((timestamp + interval_ns - 1) / interval_ns) * interval_ns;
+            clock_started = true;
+        }
+        else if (timestamp > next_sample_time)
+        {
+            // The pending change is stamped with the first tick after it; later
+            // ticks with no change are skipped and carry that row forward
+            if (book_dirty)
+                takeSnapshot(next_sample_time);
+            next_sample_time = ((timestamp + interval_ns - 1) / interval_ns) * interval_ns;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void MBPReconstructor::onBookChanged(uint64_t timestamp)
+{
+    switch (my_config.mode)
+    {
+    case SnapshotMode::EveryEvent:
+        takeSnapshot(timestamp);
+        break;
+    case SnapshotMode::SampleEvents:
+        changes_since_start++;
+        last_change_timestamp = timestamp;
+        if (changes_since_start % my_config.interval == 0)
+            takeSnapshot(timestamp);
+        else
+            book_dirty = true;
+        break;
+    default:
+        book_dirty = true;
+        last_change_timestamp = timestamp;
+        break;
+    }
+}
+
+void MBPReconstructor::flush()
+{
+    if (book_dirty)
+    {
+        if (my_config.mode == SnapshotMode::SampleTime)
+            takeSnapshot(next_sample_time);
+        else
+            takeSnapshot(last_change_timestamp);
+    }
+
+    if (analytics_enabled)
+        my_analytics.finish();
+}
+
+void MBPReconstructor::processAction(const MBOAction &action)
+{
+    beforeAction(action.timestamp);
+
+    switch (action.action)
+    {
+    case 'R':
+        break;
+    case 'A':
+        my_orderbook.addOrder(action.side, action.price, action.size, action.order_id);
+        onBookChanged(action.timestamp);
+        break;
+    case 'C':
+    {
+        auto it = trades_waiting_for_completion.find(action.order_id);
+        if (it != trades_waiting_for_completion.end())
+        {
+            auto &info = it->second;
+            if (info.got_trade && info.got_fill)
+            {
+                my_orderbook.processTradeSequence(info.trade_action, info.fill_action, action);
+                trades_waiting_for_completion.erase(it);
+                onBookChanged(action.timestamp);
+                break;
+            }
+        }
+        my_orderbook.cancelOrder(action.order_id);
+        onBookChanged(action.timestamp);
+        break;
+    }
+    case 'T':
+        if (action.side != 'N')
+        {
+            auto &info = trades_waiting_for_completion[action.order_id];
+            info.trade_action = action;
+            info.got_trade = true;
+        }
+        break;
+    case 'F':
+    {
+        auto &info = trades_waiting_for_completion[action.order_id];
+        info.fill_action = action;
+        info.got_fill = true;
+        break;
+    }
+    default:
+        std::cerr << "Unknown action: " << action.action << std::endl;
+        break;
+    }
+}
+
+bool MBPReconstructor::reconstruct(const std::string &input_file, const std::string &output_file)
+{
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    reset();
+    if (!my_csv_parser.parseCSV(input_file, my_actions))
+        return false;
+    if (analytics_enabled)
+        my_analytics.reserve(my_actions.size());
+
+    for (const auto &action : my_actions)
+    {
+        processAction(action);
+    }
+    event_count = my_actions.size();
+
+    return finishRun(output_file, start_time);
+}
+
+bool MBPReconstructor::reconstructMerged(const std::vector<std::string> &input_files, const std::string &output_file)
+{
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    reset();
+    MBOMerger merger(input_files);
+    if (!merger.allOpen())
+        return false;
+
+    MBOAction action;
+    while (merger.next(action))
+    {
+        processAction(action);
+        event_count++;
+    }
+    if (!merger.allSorted())
+        return false;
+
+    return finishRun(output_file, start_time);
+}
+
+bool MBPReconstructor::finishRun(const std::string &output_file, std::chrono::high_resolution_clock::time_point start_time)
+{
+    flush();
+
+    bool ok = my_csv_parser.writeMBP(output_file, all_bid_snapshots, all_ask_snapshots);
+
+    if (!features_file.empty())
+        ok = my_analytics.writeCSV(features_file) && ok;
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+
+    if (verbose)
+    {
+        std::cout << "Reconstruction completed in " << duration.count() << " microseconds\n";
+        std::cout << "Processed " << event_count << " events\n";
+        std::cout << "Generated " << all_bid_snapshots.size() << " snapshots\n";
+    }
+    return ok;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "orderbook.h"
+#include "csv_parser.h"
+#include "analytics.h"
+#include <vector>
+#include <map>
+#include <string>
+#include <cstdint>
+#include <chrono>
+
+// Controls when a book change is turned into an MBP-10 output row
+enum class SnapshotMode
+{
+    EveryEvent,   // One row per add/cancel (original behaviour)
+    Conflate,     // One row per distinct timestamp
+    SampleTime,   // One row per clock tick of `interval` microseconds
+    SampleEvents  // One row every `interval` book-changing events
+};
+
+struct SnapshotConfig
+{
+    SnapshotMode mode;
+    uint64_t interval; // Microseconds for SampleTime, event count for SampleEvents
+
+    SnapshotConfig() : mode(SnapshotMode::EveryEvent), interval(0) {}
+    SnapshotConfig(SnapshotMode m, uint64_t i) : mode(m), interval(i) {}
+};
+
+class MBPReconstructor
+{
+private:
+    OrderBook my_orderbook;
+    CSVParser my_csv_parser;
+    SnapshotConfig my_config;
+    BookAnalytics my_analytics;
+    bool analytics_enabled = false;
+    std::string features_file; // Empty = compute features but do not write them
+    bool verbose = true;
+
+    MBOActionBuffer my_actions; // Kept across runs so a pooled reconstructor reuses its capacity
+    size_t event_count = 0;
+
+    MBPSnapshotBuffer all_bid_snapshots;
+    MBPSnapshotBuffer all_ask_snapshots;
+
+    struct TradeInProgress
+    {
+        MBOAction trade_action;
+        MBOAction fill_action;
+        bool got_trade = false;
+        bool got_fill = false;
+    };
+
+    std::map<uint64_t, TradeInProgress> trades_waiting_for_completion;
+
+    // Pending-change state for the conflating/sampling modes
+    bool book_dirty = false;
+    uint64_t last_change_timestamp = 0;
+    uint64_t changes_since_start = 0;
+    uint64_t next_sample_time = 0; // In timestamp units (nanoseconds)
+    bool clock_started = false;
+
+    void takeSnapshot(uint64_t timestamp);
+    bool finishRun(const std::string &output_file, std::chrono::high_resolution_clock::time_point start_time);
+    void beforeAction(uint64_t timestamp);
+    void onBookChanged(uint64_t timestamp);
+
+public:
+    explicit MBPReconstructor(const SnapshotConfig &config = SnapshotConfig());
+
+    void reset(); // Clear all book and snapshot state, keeping allocated capacity
+    void processAction(const MBOAction &action);
+    void flush(); // Emit any change still held back by conflation/sampling
+    void enableAnalytics(const std::string &output_file = "")
+    {
+        analytics_enabled = true;
+        features_file = output_file;
+    }
+
+    void setVerbose(bool enabled) { verbose = enabled; }
+
+    // Main reconstruction function; false if the input or output file could not be opened
+    bool reconstruct(const std::string &input_file, const std::string &output_file);
+    // Streams several sorted inputs through a timestamp merge instead of loading one file
+    bool reconstructMerged(const std::vector<std::string> &input_files, const std::string &output_file);
+    size_t getEventCount() const { return event_count; }
+
+    const MBPSnapshotBuffer &getBidSnapshots() const { return all_bid_snapshots; }
+    const MBPSnapshotBuffer &getAskSnapshots() const { return all_ask_snapshots; }
+    const BookAnalytics &getAnalytics() const { return my_analytics; }
+    const OrderBook &getOrderBook() const { return my_orderbook; }
+    // Records every price-level change made from now on (nullptr to stop)
+    void setLevelLog(std::vector<LevelUpdate> *log) { my_orderbook.setLevelLog(log); }
+};
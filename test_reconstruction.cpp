@@ -1,10 +1,25 @@
 #include "orderbook.h"
 #include "csv_parser.h"
+#include "reconstructor.h"
+#include "book_server.h"
+#include "batch.h"
+#include "merge.h"
 #include <iostream>
 #include <cassert>
 #include <chrono>
 #include <fstream>
 #include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <thread>
+#include <random>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
 
 class TestSuite
 {
@@ -194,6 +209,465 @@ public:
             assert_equal(0, bids[i].size, "Zero-padded size level " + std::to_string(i));
         }
     }
+    void test_snapshot_modes()
+    {
+        std::cout << "\n=== Testing Snapshot Modes ===" << std::endl;
+
+        // Three adds at t=1000, one at t=2500, one cancel at t=4000 (ns)
+        std::vector<MBOAction> actions(5);
+        const uint64_t timestamps[] = {1000, 1000, 1000, 2500, 4000};
+        for (int i = 0; i < 5; i++)
+        {
+            actions[i].timestamp = timestamps[i];
+            actions[i].action = 'A';
+            actions[i].side = 'B';
+            actions[i].price = 99.50 - i * 0.01;
+            actions[i].size = 100;
+            actions[i].order_id = 2000 + i;
+        }
+        actions[4].action = 'C';
+        actions[4].order_id = 2000;
+
+        MBPReconstructor every;
+        MBPReconstructor conflate(SnapshotConfig(SnapshotMode::Conflate, 0));
+        MBPReconstructor by_time(SnapshotConfig(SnapshotMode::SampleTime, 2));
+        MBPReconstructor by_events(SnapshotConfig(SnapshotMode::SampleEvents, 2));
+        for (const auto &action : actions)
+        {
+            every.processAction(action);
+            conflate.processAction(action);
+            by_time.processAction(action);
+            by_events.processAction(action);
+        }
+        every.flush();
+        conflate.flush();
+        by_time.flush();
+        by_events.flush();
+
+        assert_equal(5, static_cast<int64_t>(every.getBidSnapshots().size()), "Every-event snapshot count");
+
+        const auto &conflated = conflate.getBidSnapshots();
+        assert_equal(3, static_cast<int64_t>(conflated.size()), "Conflated snapshot count");
+        assert_equal(1000, static_cast<int64_t>(conflated.getTimestamp(0)), "Conflated first timestamp");
+        const MBPLevel *first_row = conflated.getLevels(0);
+        assert_equal(300, first_row[0].size + first_row[1].size + first_row[2].size,
+                     "Conflated row holds all same-timestamp adds");
+
+        // 2us clock: ticks at 2000 (after t=1000) and 4000 (after t=2500, t=4000)
+        const auto &sampled = by_time.getBidSnapshots();
+        assert_equal(2, static_cast<int64_t>(sampled.size()), "Time-sampled snapshot count");
+        assert_equal(2000, static_cast<int64_t>(sampled.getTimestamp(0)), "First clock tick timestamp");
+        assert_equal(4000, static_cast<int64_t>(sampled.getTimestamp(1)), "Final clock tick timestamp");
+
+        // A gap of several ticks: the t=1000 change belongs to tick 2000, not the last tick before t=9000
+        MBPReconstructor gapped(SnapshotConfig(SnapshotMode::SampleTime, 2));
+        gapped.processAction(actions[0]);
+        MBOAction late = actions[3];
+        late.timestamp = 9000;
+        gapped.processAction(late);
+        gapped.flush();
+        const auto &gap_rows = gapped.getBidSnapshots();
+        assert_equal(2, static_cast<int64_t>(gap_rows.size()), "Gapped clock snapshot count");
+        assert_equal(2000, static_cast<int64_t>(gap_rows.getTimestamp(0)), "Change stamped with first tick after it");
+        assert_equal(10000, static_cast<int64_t>(gap_rows.getTimestamp(1)), "Next tick at or after the late event");
+
+        const auto &counted = by_events.getBidSnapshots();
+        assert_equal(3, static_cast<int64_t>(counted.size()), "Event-sampled snapshot count");
+        assert_equal(4000, static_cast<int64_t>(counted.getTimestamp(2)), "Event-sampled flush timestamp");
+    }
+
+    void test_book_analytics()
+    {
+        std::cout << "\n=== Testing Book Analytics ===" << std::endl;
+
+        OrderBook book;
+        BookAnalytics analytics;
+        book.addOrder('B', 99.00, 100, 3001);
+        book.addOrder('A', 101.00, 300, 3002);
+        analytics.append(1000, book.getBidLevels(10), book.getAskLevels(10));
+        book.addOrder('B', 98.00, 200, 3003);
+        analytics.append(2000, book.getBidLevels(10), book.getAskLevels(10));
+        analytics.finish();
+
+        assert_equal(2.0, analytics.getSpread(0), "Spread");
+        assert_equal(100.0, analytics.getMid(0), "Mid price");
+        assert_equal((99.00 * 300 + 101.00 * 100) / 400.0, analytics.getMicroprice(0), "Microprice");
+        assert_equal((100.0 - 300.0) / 400.0, analytics.getImbalance(0), "Top-level imbalance");
+        assert_equal((100.0 + 0.5 * 200 - 300.0) / (100.0 + 0.5 * 200 + 300.0), analytics.getImbalance(1),
+                     "Depth-weighted imbalance");
+        assert_equal(300.0, analytics.getBidDepth(1, 1), "Cumulative bid depth at level 2");
+        assert_equal(300.0, analytics.getAskDepth(1, 9), "Cumulative ask depth at level 10");
+        assert_equal(static_cast<int64_t>(1u | (1u << 10)), static_cast<int64_t>(analytics.getChangedLevels(0)),
+                     "Initial change flags");
+        assert_equal(static_cast<int64_t>(1u << 1), static_cast<int64_t>(analytics.getChangedLevels(1)),
+                     "Only second bid level flagged");
+
+        // An empty ask side zeroes the top-of-book features instead of dividing by an empty level
+        BookAnalytics one_sided;
+        one_sided.append(1000, book.getBidLevels(10), OrderBook().getAskLevels(10));
+        one_sided.finish();
+        assert_equal(0.0, one_sided.getSpread(0), "Spread with empty ask side");
+        assert_equal(0.0, one_sided.getMicroprice(0), "Microprice with empty ask side");
+
+        assert_equal(0, static_cast<int64_t>(analytics.writeCSV("/nonexistent_dir/features.csv")),
+                     "Unwritable features file reported");
+        std::ofstream input("test_features_input.csv");
+        input << "timestamp,action,side,price,size,order_id\n1000,A,B,99.50,100,1\n";
+        input.close();
+        MBPReconstructor reconstructor;
+        reconstructor.setVerbose(false);
+        reconstructor.enableAnalytics("/nonexistent_dir/features.csv");
+        assert_equal(0, static_cast<int64_t>(reconstructor.reconstruct("test_features_input.csv", "test_features_out.csv")),
+                     "Reconstruction fails when the features file cannot be written");
+        std::remove("test_features_input.csv");
+        std::remove("test_features_out.csv");
+    }
+
+    void test_book_history()
+    {
+        std::cout << "\n=== Testing Book History Queries ===" << std::endl;
+
+        // 12 bid adds two per timestamp (t=100,100,200,200,...), deeper than MBP-10 by the end
+        MBOActionBuffer actions(12);
+        for (int i = 0; i < 12; i++)
+        {
+            actions[i].timestamp = 100 * (i / 2 + 1);
+            actions[i].action = 'A';
+            actions[i].side = 'B';
+            actions[i].price = 99.00 - i * 0.01;
+            actions[i].size = 10 + i;
+            actions[i].order_id = 4000 + i;
+        }
+
+        BookHistory history;
+        history.build(actions, SnapshotConfig(SnapshotMode::Conflate, 0), 4);
+
+        assert_equal(6, static_cast<int64_t>(history.size()), "One conflated snapshot per timestamp");
+        assert_equal(-1, static_cast<int64_t>(history.findSnapshot(50)), "No book before first event");
+        long row = history.findSnapshot(250);
+        assert_equal(200, static_cast<int64_t>(history.getTimestamp(row)), "Book at T uses latest snapshot <= T");
+        assert_equal(13, history.getBids(row)[3].size, "Book at T holds all four bids");
+
+        auto range = history.findRange(200, 400);
+        assert_equal(3, static_cast<int64_t>(range.second - range.first), "Snapshots in [T1,T2]");
+
+        const BookHistory::Checkpoint *checkpoint = history.findCheckpoint(10000);
+        assert_equal(600, static_cast<int64_t>(checkpoint->timestamp), "Final checkpoint timestamp");
+        assert_equal(12, static_cast<int64_t>(checkpoint->bids.size()), "Checkpoint keeps full depth");
+        checkpoint = history.findCheckpoint(399);
+        assert_equal(200, static_cast<int64_t>(checkpoint->timestamp), "Checkpoints fall on timestamp boundaries");
+
+        // 30 bid adds at t=100..3000, checkpoint every 10: T=2550 lies between the checkpoints at 2000 and 3000
+        MBOActionBuffer deep(30);
+        for (int i = 0; i < 30; i++)
+        {
+            deep[i].timestamp = 100 * (i + 1);
+            deep[i].action = 'A';
+            deep[i].side = 'B';
+            deep[i].price = 99.00 - i * 0.01;
+            deep[i].size = 1;
+            deep[i].order_id = 6000 + i;
+        }
+        BookHistory deep_history;
+        deep_history.build(deep, SnapshotConfig(), 10);
+
+        std::vector<MBPLevel> bids, asks;
+        uint64_t as_of = 0;
+        bool found = deep_history.topLevelsAt(2550, 30, bids, asks, as_of);
+        assert_equal(1, static_cast<int64_t>(found), "Deep top-N between checkpoints found");
+        assert_equal(2500, static_cast<int64_t>(as_of), "Deep top-N reports last event applied");
+        assert_equal(98.76, bids[24].price, "Deep top-N replays past the checkpoint to level 25");
+        assert_equal(0, bids[25].size, "Deep top-N has no level 26 at T");
+        found = deep_history.topLevelsAt(550, 30, bids, asks, as_of);
+        assert_equal(5, static_cast<int64_t>(found ? bids[4].size + bids[3].size + bids[2].size + bids[1].size + bids[0].size : 0),
+                     "Deep top-N before the first checkpoint replays from the start");
+        assert_equal(0, static_cast<int64_t>(deep_history.topLevelsAt(50, 30, bids, asks, as_of)),
+                     "Deep top-N before the day is not found");
+
+        // Random adds, cancels and T/F/C trades: the overlay must match a full replay at any T
+        std::mt19937 rng(7);
+        MBOActionBuffer mixed;
+        std::vector<MBOAction> resting;
+        for (int i = 0; i < 3000; i++)
+        {
+            MBOAction action;
+            action.timestamp = 1000 + i / 3;
+            if (resting.size() > 20 && rng() % 3 == 0)
+            {
+                size_t pick = rng() % resting.size();
+                MBOAction order = resting[pick];
+                resting.erase(resting.begin() + pick);
+                action.side = order.side;
+                action.price = order.price;
+                action.order_id = order.order_id;
+                action.size = order.size;
+                if (rng() % 2 == 0)
+                {
+                    MBOAction trade = action;
+                    trade.action = 'T';
+                    trade.size = 1;
+                    MBOAction fill = trade;
+                    fill.action = 'F';
+                    mixed.push_back(trade);
+                    mixed.push_back(fill);
+                }
+                action.action = 'C';
+            }
+            else
+            {
+                action.action = 'A';
+                action.side = rng() % 2 == 0 ? 'B' : 'A';
+                action.price = (action.side == 'B' ? 99.00 - (rng() % 60) * 0.01 : 101.00 + (rng() % 60) * 0.01);
+                action.size = 1 + rng() % 50;
+                action.order_id = 10000 + i;
+                resting.push_back(action);
+            }
+            mixed.push_back(action);
+        }
+        BookHistory mixed_history;
+        mixed_history.build(mixed, SnapshotConfig(), 100);
+
+        bool all_match = true;
+        for (uint64_t t = 1000; t <= 2000 && all_match; t += 37)
+        {
+            MBPReconstructor replay;
+            replay.setVerbose(false);
+            for (const auto &action : mixed)
+            {
+                if (action.timestamp <= t)
+                    replay.processAction(action);
+            }
+            found = mixed_history.topLevelsAt(t, 40, bids, asks, as_of);
+            auto expected_bids = replay.getOrderBook().getBidLevels(40);
+            auto expected_asks = replay.getOrderBook().getAskLevels(40);
+            for (int l = 0; l < 40 && found; l++)
+            {
+                found = bids[l].price == expected_bids[l].price && bids[l].size == expected_bids[l].size &&
+                        asks[l].price == expected_asks[l].price && asks[l].size == expected_asks[l].size;
+            }
+            all_match = found;
+        }
+        assert_equal(1, static_cast<int64_t>(all_match), "Checkpoint overlay matches a full replay with trades");
+
+        // stop() must shut down a connection that is still open and join its thread
+        std::string socket_path = "/tmp/test_book_server_" + std::to_string(getpid()) + ".sock";
+        BookServer server(deep_history, socket_path);
+        bool started = server.start();
+        assert_equal(1, static_cast<int64_t>(started), "Server starts");
+        if (!started)
+            return;
+        std::thread accept_thread(&BookServer::run, &server);
+
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        bool connected = fd >= 0 && connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+
+        QueryRequest request = {QUERY_TOP_N, 25, 2550, 0};
+        QueryResponseHeader header = {0, 0, 0, 0};
+        bool answered = connected && writeFull(fd, &request, sizeof(request)) && readFull(fd, &header, sizeof(header));
+        assert_equal(1, static_cast<int64_t>(answered), "Server answers over the socket");
+        assert_equal(2500, static_cast<int64_t>(header.t1), "Server replays deep top-N");
+        std::vector<WireLevel> levels(2 * header.count);
+        if (answered)
+            readFull(fd, levels.data(), levels.size() * sizeof(WireLevel));
+
+        server.stop();
+        accept_thread.join();
+        char byte;
+        assert_equal(0, static_cast<int64_t>(connected ? read(fd, &byte, 1) : 0), "Stop closes open client connections");
+        if (fd >= 0)
+            close(fd);
+    }
+
+    void test_numa_placement()
+    {
+        std::cout << "\n=== Testing NUMA Placement and Huge-Page Buffers ===" << std::endl;
+
+        const std::vector<int> expected_cpus = {0, 1, 2, 3, 8, 10, 11};
+        assert_equal(1, static_cast<int64_t>(parseCpuList("0-3,8,10-11") == expected_cpus), "CPU list ranges and commas");
+        assert_equal(1, static_cast<int64_t>(parseCpuList("5") == std::vector<int>{5}), "CPU list single CPU");
+        assert_equal(0, static_cast<int64_t>(parseCpuList("").size()), "CPU list empty");
+
+        // Pin a scratch thread to the first CPU this process may use, and read the placement back
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        sched_getaffinity(0, sizeof(allowed), &allowed);
+        int cpu = 0;
+        while (cpu < CPU_SETSIZE && !CPU_ISSET(cpu, &allowed))
+            cpu++;
+
+        bool placed = false;
+        int pinned_count = 0;
+        bool pinned_to_cpu = false;
+        long policy = -1;
+        std::thread([&]
+                    {
+                        placed = applyWorkerPlacement(WorkerPlacement(cpu, -1, HugePageMode::Off));
+                        cpu_set_t set;
+                        CPU_ZERO(&set);
+                        sched_getaffinity(0, sizeof(set), &set);
+                        pinned_count = CPU_COUNT(&set);
+                        pinned_to_cpu = CPU_ISSET(cpu, &set);
+                        int mode = -1;
+                        unsigned long mask = 0;
+                        if (syscall(SYS_get_mempolicy, &mode, &mask, 8 * sizeof(mask) + 1, nullptr, 0) == 0)
+                            policy = mode;
+                    })
+            .join();
+        assert_equal(1, static_cast<int64_t>(placed), "Worker placement succeeded");
+        assert_equal(1, static_cast<int64_t>(pinned_count), "Worker pinned to exactly one CPU");
+        assert_equal(1, static_cast<int64_t>(pinned_to_cpu), "Worker pinned to the requested CPU");
+        assert_equal(MPOL_BIND, static_cast<int64_t>(policy), "Worker memory bound to its node");
+
+        // Large enough to take the mmap path, grown across several reallocations
+        MBOActionBuffer actions;
+        for (int i = 0; i < 200000; i++)
+        {
+            MBOAction action;
+            action.order_id = i;
+            actions.push_back(action);
+        }
+        assert_equal(199999, static_cast<int64_t>(actions.back().order_id), "Huge-page buffer keeps contents");
+        assert_equal(0, static_cast<int64_t>(reinterpret_cast<uintptr_t>(actions.data()) % (2 * 1024 * 1024)),
+                     "Large buffer is huge-page aligned");
+    }
+
+    void test_batch_runner()
+    {
+        std::cout << "\n=== Testing Batch Runner ===" << std::endl;
+
+        assert_equal(1, static_cast<int64_t>(expandOutputTemplate("out/{stem}.mbp.{index}.csv", "data/ES_20240102.csv", 7) ==
+                                             "out/ES_20240102.mbp.7.csv"),
+                     "Output template expansion");
+
+        const char *inputs[] = {"test_batch_a.csv", "test_batch_b.csv"};
+        for (int f = 0; f < 2; f++)
+        {
+            std::ofstream file(inputs[f]);
+            file << "timestamp,action,side,price,size,order_id\n";
+            for (int i = 0; i <= f; i++)
+                file << 1000 + i << ",A,B," << 99.50 - i * 0.01 << ",100," << 5000 + i << "\n";
+        }
+        std::ofstream manifest("test_batch_manifest.txt");
+        manifest << "# nightly batch\n" << inputs[0] << "\n" << inputs[1] << "\n\n"
+                 << "test_batch_missing.csv\n";
+        manifest.close();
+
+        auto listed = listBatchInputs("test_batch_manifest.txt");
+        assert_equal(3, static_cast<int64_t>(listed.size()), "Manifest entries");
+
+        std::vector<BatchTask> tasks;
+        assert_equal(0, static_cast<int64_t>(makeBatchTasks({"a/day.csv", "b/day.csv"}, "out/{stem}.csv", tasks)),
+                     "Batch rejects two inputs with the same output");
+        assert_equal(0, static_cast<int64_t>(makeBatchTasks({"a/day.csv"}, "{dir}/{name}", tasks)),
+                     "Batch rejects an output that overwrites its input");
+        assert_equal(1, static_cast<int64_t>(makeBatchTasks({"a/day.csv", "b/day.csv"}, "{dir}/{stem}_mbp.csv", tasks) &&
+                                             tasks[1].output_file == "b/day_mbp.csv"),
+                     "Default-style template keeps outputs apart by directory");
+
+        BatchRunner runner(SnapshotConfig(), 2, false, HugePageMode::Off);
+        makeBatchTasks(listed, "{stem}_out.csv", tasks);
+        auto results = runner.run(tasks);
+
+        assert_equal(1, static_cast<int64_t>(results[0].ok), "First batch file succeeded");
+        assert_equal(2, static_cast<int64_t>(results[1].snapshots), "Second batch file snapshot count");
+        assert_equal(0, static_cast<int64_t>(results[2].ok), "Missing batch file reported as failure");
+
+        std::ifstream output("test_batch_b_out.csv");
+        assert_equal(1, static_cast<int64_t>(output.good()), "Batch output written from template");
+
+        // One reconstructor through both files, as a pooled worker would: nothing of file a may survive
+        // (both files add order 5000 at 99.50, so a stale book would show 200 there)
+        MBPReconstructor pooled;
+        pooled.setVerbose(false);
+        pooled.reconstruct(inputs[0], "test_batch_a_out.csv");
+        pooled.reconstruct(inputs[1], "test_batch_b_out.csv");
+        assert_equal(2, static_cast<int64_t>(pooled.getEventCount()), "Reset clears the event count");
+        assert_equal(2, static_cast<int64_t>(pooled.getBidSnapshots().size()), "Reset clears the snapshots");
+        assert_equal(1000, static_cast<int64_t>(pooled.getBidSnapshots().getTimestamp(0)), "Reset drops earlier rows");
+        assert_equal(100, pooled.getBidSnapshots().getLevels(1)[0].size, "Reset clears the order book");
+        assert_equal(2, static_cast<int64_t>(pooled.getOrderBook().getBidDepth()), "Reset leaves only file b's levels");
+
+        for (const char *path : {"test_batch_a.csv", "test_batch_b.csv", "test_batch_manifest.txt",
+                                 "test_batch_a_out.csv", "test_batch_b_out.csv"})
+            std::remove(path);
+    }
+
+    void test_kway_merge()
+    {
+        std::cout << "\n=== Testing K-way MBO Merge ===" << std::endl;
+
+        // Source 0 has no sequence column; sources 1 and 2 tie at t=300 and are ordered by sequence
+        std::ofstream a("test_merge_0.csv"), b("test_merge_1.csv"), c("test_merge_2.csv");
+        a << "timestamp,action,side,price,size,order_id\n"
+          << "100,A,B,99.50,10,1\n500,A,B,99.40,10,2\n700,C,B,99.50,10,1\n";
+        b << "timestamp,action,side,price,size,order_id,sequence\n"
+          << "200,A,A,100.50,10,3,1\n300,A,A,100.60,10,4,9\n";
+        c << "timestamp,action,side,price,size,order_id,sequence\n"
+          << "300,A,A,100.70,10,5,4\n300,A,A,100.80,10,6,12\n600,C,A,100.70,10,5,13\n";
+        a.close();
+        b.close();
+        c.close();
+
+        // Tiny chunks with one chunk of read-ahead force the readers through their back-pressure path
+        MBOMerger merger({"test_merge_0.csv", "test_merge_1.csv", "test_merge_2.csv"}, 1, 1);
+        std::vector<uint64_t> order;
+        MBOAction action;
+        while (merger.next(action))
+            order.push_back(action.order_id);
+
+        const uint64_t expected[] = {1, 3, 5, 4, 6, 2, 5, 1};
+        assert_equal(8, static_cast<int64_t>(order.size()), "Merged event count");
+        bool in_order = order.size() == 8 && std::equal(order.begin(), order.end(), expected);
+        assert_equal(1, static_cast<int64_t>(in_order), "Merged by timestamp, then sequence");
+
+        MBPReconstructor reconstructor;
+        reconstructor.setVerbose(false);
+        bool ok = reconstructor.reconstructMerged({"test_merge_0.csv", "test_merge_1.csv", "test_merge_2.csv"},
+                                                  "test_merge_out.csv");
+        assert_equal(1, static_cast<int64_t>(ok), "Merged reconstruction succeeded");
+        assert_equal(8, static_cast<int64_t>(reconstructor.getEventCount()), "Merged reconstruction event count");
+        const auto &ask_rows = reconstructor.getAskSnapshots();
+        const MBPLevel *asks = ask_rows.getLevels(ask_rows.size() - 1);
+        assert_equal(100.50, asks[0].price, "Best ask after merged stream");
+        assert_equal(100.80, asks[2].price, "Third ask after merged stream");
+
+        MBPReconstructor missing;
+        missing.setVerbose(false);
+        assert_equal(0, static_cast<int64_t>(missing.reconstructMerged({"test_merge_0.csv", "test_merge_none.csv"},
+                                                                        "test_merge_out.csv")),
+                     "Missing merge source reported");
+
+        // Sequence goes backwards within t=400, then the timestamp goes backwards
+        std::ofstream bad_sequence("test_merge_bad_seq.csv"), bad_time("test_merge_bad_time.csv");
+        bad_sequence << "timestamp,action,side,price,size,order_id,sequence\n"
+                     << "100,A,B,99.50,10,7,1\n400,A,B,99.40,10,8,5\n400,A,B,99.30,10,9,2\n";
+        bad_time << "timestamp,action,side,price,size,order_id\n"
+                 << "100,A,B,99.50,10,7\n400,A,B,99.40,10,8\n350,A,B,99.30,10,9\n";
+        bad_sequence.close();
+        bad_time.close();
+
+        MBOMerger unsorted({"test_merge_bad_seq.csv", "test_merge_1.csv"}, 1, 1);
+        size_t delivered = 0;
+        while (unsorted.next(action))
+            delivered++;
+        assert_equal(4, static_cast<int64_t>(delivered), "Merge stops at the out-of-order event");
+        assert_equal(0, static_cast<int64_t>(unsorted.allSorted()), "Sequence regression detected");
+
+        MBPReconstructor unsorted_run;
+        unsorted_run.setVerbose(false);
+        assert_equal(0, static_cast<int64_t>(unsorted_run.reconstructMerged({"test_merge_bad_time.csv", "test_merge_1.csv"},
+                                                                             "test_merge_out.csv")),
+                     "Timestamp regression fails the merged run");
+
+        for (const char *path : {"test_merge_0.csv", "test_merge_1.csv", "test_merge_2.csv", "test_merge_out.csv",
+                                 "test_merge_bad_seq.csv", "test_merge_bad_time.csv"})
+            std::remove(path);
+    }
+
     void run_all_tests()
     {
         std::cout << "Starting MBP-10 Reconstruction Test Suite" << std::endl;
@@ -203,6 +677,12 @@ public:
         test_trade_sequence();
         test_csv_parsing();
         test_mbp_levels();
+        test_snapshot_modes();
+        test_book_analytics();
+        test_book_history();
+        test_numa_placement();
+        test_batch_runner();
+        test_kway_merge();
         test_performance();
 
         std::cout << "\n=== Test Results ===" << std::endl;